@@ -0,0 +1,188 @@
+#include <array>
+#include <atomic>
+#include <thread>
+#include <benchmark/benchmark.h>
+
+#include "timer_wheel.h"
+
+// 触发精度：记录 (实际触发时间 - 预定时间)，按 precision_tt x 驱动方式 x 背景负载 输出 p50/p99/p99.9/max
+
+// 近似 HDR 的对数-线性直方图（单位 us，相对误差 ~1/32）
+class lateness_histogram {
+ private:
+    static constexpr uint64_t _sub_bits = 5;
+    static constexpr uint64_t _sub_count = 1ull << _sub_bits;
+
+    std::array<uint64_t, (64 - _sub_bits + 1) * _sub_count> _counts{};
+    uint64_t _total = 0;
+    uint64_t _max = 0;
+
+    static uint64_t msb(uint64_t value) {
+        uint64_t result = 0;
+        while (value >>= 1)
+            ++result;
+        return result;
+    }
+
+    static std::size_t index(uint64_t value) {
+        if (value < _sub_count)
+            return value;
+        const uint64_t shift = msb(value) - _sub_bits;
+        return ((shift + 1) << _sub_bits) + ((value >> shift) & (_sub_count - 1));
+    }
+
+    static uint64_t upper(std::size_t idx) {
+        if (idx < _sub_count)
+            return idx;
+        const uint64_t shift = (idx >> _sub_bits) - 1;
+        const uint64_t base = (_sub_count | (idx & (_sub_count - 1))) << shift;
+        return base + (1ull << shift) - 1;
+    }
+
+ public:
+    void record(uint64_t value) {
+        _counts[index(value)] += 1;
+        _total += 1;
+        _max = std::max(_max, value);
+    }
+
+    uint64_t total() const {
+        return _total;
+    }
+
+    uint64_t max() const {
+        return _max;
+    }
+
+    uint64_t percentile(double pct) const {
+        if (_total == 0)
+            return 0;
+        const auto target = static_cast<uint64_t>(pct / 100.0 * static_cast<double>(_total) + 0.5);
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < _counts.size(); ++i) {
+            seen += _counts[i];
+            if (seen >= std::max<uint64_t>(target, 1))
+                return std::min(upper(i), _max);
+        }
+        return _max;
+    }
+};
+
+enum class drive_strategy : int64_t {
+    busy_poll = 0,        // execute() 空转
+    sleep_precision = 1,  // execute() + sleep(precision)
+    sleep_1ms = 2,        // execute() + sleep(1ms)
+};
+
+enum class background_load : int64_t {
+    none = 0,
+    cpu_callbacks = 1,    // 混入每次耗时 ~200us 的回调
+    concurrent_adds = 2,  // 另一线程持续 add
+    catch_up_gaps = 3,    // 驱动线程周期性卡顿 20ms
+};
+
+static uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(timer::time_clock::now().time_since_epoch()).count();
+}
+
+static void burn_us(uint64_t us) {
+    const auto until = now_us() + us;
+    while (now_us() < until) {
+    }
+}
+
+static constexpr int probe_count = 200;       // 每轮探针定时器数
+static constexpr uint32_t probe_window = 200;  // 探针分布在 [0, 200) ms 内
+
+template <uint64_t precision_tt>
+static void BM_fire_lateness(benchmark::State& state) {
+    const auto drive = static_cast<drive_strategy>(state.range(0));
+    const auto load = static_cast<background_load>(state.range(1));
+
+    timer::timer_wheel<precision_tt, std::mutex> tw;
+    lateness_histogram histogram;
+    uint64_t early = 0;
+    uint64_t max_early = 0;
+    uint32_t seed = 12345;
+    auto rand = [&seed]() {
+        seed = seed * 214013 + 2531011;
+        return (seed >> 16) & 0x7fff;
+    };
+
+    for (auto _ : state) {
+        int fired = 0;
+        for (int i = 0; i < probe_count; ++i) {
+            const uint32_t when = rand() % probe_window;
+            const uint64_t deadline = now_us() + when * 1000ull;
+            tw.add(std::chrono::milliseconds(when), [&, deadline](timer::timer_handle) {
+                const uint64_t actual = now_us();
+                if (actual < deadline) {
+                    early += 1;
+                    max_early = std::max(max_early, deadline - actual);
+                }
+                histogram.record(actual > deadline ? actual - deadline : 0);
+                fired += 1;
+            });
+            if (load == background_load::cpu_callbacks && i % 10 == 0) {
+                tw.add(std::chrono::milliseconds(rand() % probe_window), [](timer::timer_handle) { burn_us(200); });
+            }
+        }
+
+        std::atomic<bool> running = true;
+        std::thread producer;
+        if (load == background_load::concurrent_adds) {
+            producer = std::thread([&tw, &running]() {
+                uint32_t local = 54321;
+                while (running.load(std::memory_order_relaxed)) {
+                    local = local * 214013 + 2531011;
+                    tw.add(std::chrono::milliseconds((local >> 16) % probe_window), [](timer::timer_handle) {});
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            });
+        }
+
+        auto last_gap = now_us();
+        while (fired < probe_count) {
+            tw.execute();
+            if (load == background_load::catch_up_gaps && now_us() - last_gap > 50000) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                last_gap = now_us();
+            }
+            switch (drive) {
+                case drive_strategy::busy_poll:
+                    break;
+                case drive_strategy::sleep_precision:
+                    std::this_thread::sleep_for(std::chrono::milliseconds(precision_tt));
+                    break;
+                case drive_strategy::sleep_1ms:
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    break;
+            }
+        }
+
+        running = false;
+        if (producer.joinable())
+            producer.join();
+    }
+
+    state.counters["p50_us"] = static_cast<double>(histogram.percentile(50.0));
+    state.counters["p99_us"] = static_cast<double>(histogram.percentile(99.0));
+    state.counters["p99.9_us"] = static_cast<double>(histogram.percentile(99.9));
+    state.counters["max_us"] = static_cast<double>(histogram.max());
+    state.counters["early"] = static_cast<double>(early);  // 按 precision 向下取整导致的提前触发
+    state.counters["max_early_us"] = static_cast<double>(max_early);
+    state.counters["samples"] = static_cast<double>(histogram.total());
+}
+
+#define LATENCY_BENCHMARK(precision) \
+    BENCHMARK_TEMPLATE(BM_fire_lateness, precision) \
+        ->ArgNames({"drive", "load"}) \
+        ->ArgsProduct({{0, 1, 2}, {0, 1, 2, 3}}) \
+        ->Iterations(5) \
+        ->Unit(benchmark::kMillisecond) \
+        ->UseRealTime()
+
+LATENCY_BENCHMARK(1);
+LATENCY_BENCHMARK(5);
+LATENCY_BENCHMARK(10);
+LATENCY_BENCHMARK(50);
@@ -4,6 +4,7 @@
 #include <benchmark/benchmark.h>
 
 #include "timer_wheel.h"
+#include "timer_reference.h"
 
 const int MaxN = 50000;   // max timer count
 
@@ -18,10 +19,19 @@ uint32_t lcg_rand(uint32_t& seed) {
     return r;
 }
 
-static std::shared_ptr<timer::timer_wheel<1>> add_timer(benchmark::State& state) {
+// 对照组，见 timer_reference.h
+using wheel_timer = timer::timer_wheel<1>;
+using binary_heap_timer = timer::reference::heap_timer<1, 2>;
+using quad_heap_timer = timer::reference::heap_timer<1, 4>;
+using rbtree_timer = timer::reference::rbtree_timer<1>;
+using skiplist_timer = timer::reference::skiplist_timer<1>;
+using hashed_wheel_timer = timer::reference::hashed_wheel<1>;
+
+template <class timer_tt>
+static std::shared_ptr<timer_tt> add_timer(benchmark::State& state) {
     uint32_t seed = lcg_seed(12345);
 
-    auto tw = std::make_shared<timer::timer_wheel<1>>();
+    auto tw = std::make_shared<timer_tt>();
     auto dummy = [](timer::timer_handle) { };
     for (auto _ : state)
     {
@@ -31,14 +41,16 @@ static std::shared_ptr<timer::timer_wheel<1>> add_timer(benchmark::State& state)
     return tw;
 }
 
+template <class timer_tt>
 static void BM_add_timer(benchmark::State& state) {
-    auto timer = add_timer(state);
+    auto timer = add_timer<timer_tt>(state);
     benchmark::DoNotOptimize(timer);
 }
 
-static std::shared_ptr<timer::timer_wheel<1>> add_timer(int N, std::vector<timer::timer_handle>& out) {
+template <class timer_tt>
+static std::shared_ptr<timer_tt> add_timer(int N, std::vector<timer::timer_handle>& out) {
     uint32_t seed = lcg_seed(12345);
-    auto tw = std::make_shared<timer::timer_wheel<1>>();
+    auto tw = std::make_shared<timer_tt>();
     auto dummy = [](timer::timer_handle) { };
     for (int i = 0; i < N; i++)
     {
@@ -53,11 +65,12 @@ static std::shared_ptr<timer::timer_wheel<1>> add_timer(int N, std::vector<timer
     return tw;
 }
 
+template <class timer_tt>
 static void stop_timer(benchmark::State& state) {
     int N = (int)state.max_iterations;
     std::vector<timer::timer_handle> timer_ids;
     timer_ids.reserve(N);
-    auto timer = add_timer(N, timer_ids);
+    auto timer = add_timer<timer_tt>(N, timer_ids);
     for (auto _ : state)
     {
         if (timer_ids.empty()) {
@@ -70,15 +83,18 @@ static void stop_timer(benchmark::State& state) {
     benchmark::DoNotOptimize(timer);
 }
 
+template <class timer_tt>
 static void BM_stop_timer(benchmark::State& state) {
 
-    stop_timer(state);
+    stop_timer<timer_tt>(state);
 }
 
+template <class timer_tt>
 static void tick_timer(benchmark::State& state) {
+    const int N = state.range(0);
     std::vector<timer::timer_handle> timer_ids;
-    timer_ids.reserve(MaxN);
-    auto timer = add_timer(MaxN, timer_ids);
+    timer_ids.reserve(N);
+    auto timer = add_timer<timer_tt>(N, timer_ids);
     for (auto _ : state)
     {
         timer->execute();
@@ -86,11 +102,42 @@ static void tick_timer(benchmark::State& state) {
     benchmark::DoNotOptimize(timer);
 }
 
+template <class timer_tt>
 static void BM_tick_timer(benchmark::State& state) {
 
-    tick_timer(state);
+    tick_timer<timer_tt>(state);
+}
+
+// 各规模下的混合负载：持有 N 个定时器，每轮 stop 一个、add 一个、execute 一次
+template <class timer_tt>
+static void BM_churn_timer(benchmark::State& state) {
+    const int N = state.range(0);
+    uint32_t seed = lcg_seed(54321);
+    std::vector<timer::timer_handle> timer_ids;
+    timer_ids.reserve(N);
+    auto timer = add_timer<timer_tt>(N, timer_ids);
+    auto dummy = [](timer::timer_handle) { };
+    std::size_t cursor = 0;
+    for (auto _ : state)
+    {
+        timer->stop(timer_ids[cursor]);
+        uint32_t duration = lcg_rand(seed) % 5000;
+        timer_ids[cursor] = timer->add(std::chrono::milliseconds(duration), dummy);
+        cursor = (cursor + 1) % timer_ids.size();
+        timer->execute();
+    }
+    benchmark::DoNotOptimize(timer);
 }
 
-BENCHMARK(BM_add_timer);
-BENCHMARK(BM_stop_timer);
-BENCHMARK(BM_tick_timer);
\ No newline at end of file
+#define TIMER_BENCHMARK(timer_tt)                                            \
+    BENCHMARK_TEMPLATE(BM_add_timer, timer_tt);                              \
+    BENCHMARK_TEMPLATE(BM_stop_timer, timer_tt);                             \
+    BENCHMARK_TEMPLATE(BM_tick_timer, timer_tt)->Arg(1000)->Arg(MaxN);       \
+    BENCHMARK_TEMPLATE(BM_churn_timer, timer_tt)->Arg(16)->RangeMultiplier(10)->Range(1000, 1000000)
+
+TIMER_BENCHMARK(wheel_timer);
+TIMER_BENCHMARK(binary_heap_timer);
+TIMER_BENCHMARK(quad_heap_timer);
+TIMER_BENCHMARK(rbtree_timer);
+TIMER_BENCHMARK(skiplist_timer);
+TIMER_BENCHMARK(hashed_wheel_timer);
@@ -0,0 +1,176 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <benchmark/benchmark.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "timer_wheel.h"
+#include "timer_reference.h"
+
+// 每个定时器的内存占用：统计构造容器和 add 期间 operator new 的字节数与次数（含容器自身的固定开销，小实例主要看它）
+// glibc 下按 malloc_usable_size + 头部计算实际占用，其他平台只统计申请字节
+
+static std::atomic<uint64_t> alloc_bytes = 0;
+static std::atomic<uint64_t> alloc_count = 0;
+
+static void* counted_alloc(std::size_t size, std::size_t align) {
+    timer::alloc_guard::check();
+    if (size == 0)
+        size = 1;
+    void* ptr = align > alignof(std::max_align_t) ? std::aligned_alloc(align, (size + align - 1) / align * align)
+                                                  : std::malloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+#if defined(__GLIBC__)
+    size = malloc_usable_size(ptr) + sizeof(std::size_t);
+#endif
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+}
+
+// 普通 / 数组 / 对齐版本成对替换，保证每种 new 都和同一族的 delete 配对
+void* operator new(std::size_t size) {
+    return counted_alloc(size, 0);
+}
+
+void* operator new[](std::size_t size) {
+    return counted_alloc(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    return counted_alloc(size, static_cast<std::size_t>(align));
+}
+
+void* operator new[](std::size_t size, std::align_val_t align) {
+    return counted_alloc(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+template <class timer_tt>
+static void BM_memory_per_timer(benchmark::State& state) {
+    const int N = state.range(0);
+    double bytes = 0;
+    double count = 0;
+    for (auto _ : state) {
+        const uint64_t bytes_begin = alloc_bytes.load();
+        const uint64_t count_begin = alloc_count.load();
+        auto tw = std::make_unique<timer_tt>();
+        uint32_t seed = 12345;
+        for (int i = 0; i < N; i++) {
+            seed = seed * 214013 + 2531011;
+            tw->add(std::chrono::milliseconds(((seed >> 16) & 0x7fff) % 5000), [](timer::timer_handle) {});
+        }
+        bytes = double(alloc_bytes.load() - bytes_begin);
+        count = double(alloc_count.load() - count_begin);
+        benchmark::DoNotOptimize(tw);
+    }
+    state.counters["bytes_per_timer"] = bytes / N;
+    state.counters["allocs_per_timer"] = count / N;
+}
+
+// reserve() 之后的稳态：add / stop / execute / 周期定时器重排都不应再有 operator new
+static void BM_steady_state_allocs(benchmark::State& state) {
+    const int N = state.range(0);
+    timer::timer_wheel<1> tw;
+    // 槽位预留需覆盖 50ms 窗口内 stop 掉但尚未被扫到的墓碑
+    tw.reserve(N + 100000, N / 10 + 1);
+
+    std::vector<timer::timer_handle> handles(N, timer::handle_gen::invalid_handle);
+    uint32_t seed = 12345;
+    auto rand = [&seed]() {
+        seed = seed * 214013 + 2531011;
+        return (seed >> 16) & 0x7fff;
+    };
+    for (int i = 0; i < N; i++) {
+        if (i % 10 == 0)
+            handles[i] = tw.add(std::chrono::milliseconds(rand() % 50), [](timer::timer_handle) {},
+                [](std::shared_ptr<timer::event_interface>) {}, std::chrono::milliseconds(1 + rand() % 5), -1);
+        else
+            handles[i] = tw.add(std::chrono::milliseconds(rand() % 50), [](timer::timer_handle) {});
+    }
+
+    uint64_t allocs = 0;
+    std::size_t cursor = 0;
+    for (auto _ : state) {
+        const uint64_t count_begin = alloc_count.load();
+        tw.stop(handles[cursor]);
+        handles[cursor] = tw.add(std::chrono::milliseconds(rand() % 50), [](timer::timer_handle) {});
+        cursor = (cursor + 1) % handles.size();
+        tw.execute();
+        allocs += alloc_count.load() - count_begin;
+    }
+    state.counters["allocs"] = static_cast<double>(allocs);
+    if (allocs != 0)
+        state.SkipWithError("heap allocation after reserve()");
+}
+
+// 远期定时器反复 stop + add：overflow 堆里的死条目过半才整理，reserve 要按它的峰值预留
+static void BM_steady_state_overflow_churn(benchmark::State& state) {
+    const int N = state.range(0);
+    timer::timer_wheel<1> tw;
+    tw.reserve(N + 200);
+
+    std::vector<timer::timer_handle> handles(N, timer::handle_gen::invalid_handle);
+    for (int i = 0; i < N; i++)
+        handles[i] = tw.add(std::chrono::milliseconds(2000000000ll + i), [](timer::timer_handle) {});
+
+    uint64_t allocs = 0;
+    std::size_t cursor = 0;
+    for (auto _ : state) {
+        const uint64_t count_begin = alloc_count.load();
+        tw.stop(handles[cursor]);
+        handles[cursor] = tw.add(std::chrono::milliseconds(2000000000ll + cursor), [](timer::timer_handle) {});
+        cursor = (cursor + 1) % handles.size();
+        tw.execute();
+        allocs += alloc_count.load() - count_begin;
+    }
+    state.counters["allocs"] = static_cast<double>(allocs);
+    if (allocs != 0)
+        state.SkipWithError("heap allocation after reserve()");
+}
+
+BENCHMARK(BM_steady_state_allocs)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_steady_state_overflow_churn)->Arg(500)->Arg(100000);
+
+#define MEMORY_BENCHMARK(timer_tt) \
+    BENCHMARK_TEMPLATE(BM_memory_per_timer, timer_tt)->Arg(32)->Arg(100000)->Arg(1000000)->Iterations(1)
+
+MEMORY_BENCHMARK(timer::timer_wheel<1>);
+MEMORY_BENCHMARK(timer::reference::heap_timer<1>);
+MEMORY_BENCHMARK(timer::reference::rbtree_timer<1>);
@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "timer_wheel.h"
+
+// 跨圈 / 远期回归：virtual_time 下让到期时间跨过好几个时间轮一圈的边界、超出 horizon，
+// 逐个核对触发的 tick，一个不多一个不少；precision、布局（小根堆 / 时间轮）、horizon 各跑一遍
+// g++ -std=c++17 -O2 overflow_test.cpp && ./a.out
+
+template <uint64_t precision_tt>
+using virtual_timer = timer::timer_wheel<precision_tt, timer::empty_mutex, timer::alert_default,
+    timer::metrics_empty, timer::virtual_time>;
+
+static constexpr timer::time64_t wheel_ticks = timer::time64_t(1) << timer::clock::_span_bits;
+static constexpr timer::time64_t granule = timer::time64_t(1) << timer::level_shifts.back();
+static constexpr int rotations = 4;
+
+struct config {
+    const char* name;
+    bool dense;                  // adaptive(0, 0)：始终用时间轮
+    timer::time64_t horizon_ms;  // 0 表示默认
+    int randoms;                 // 随机远期定时器个数，少时一直停在小根堆模式
+};
+
+template <uint64_t precision_tt>
+static int run(const config& cfg) {
+    // 从第 3 圈结束前 5000 tick 开始，先跨一次边界
+    const timer::time64_t start = (3 * wheel_ticks - 5000) * precision_tt;
+    virtual_timer<precision_tt> tw{timer::virtual_time(start)};
+    if (cfg.dense)
+        tw.adaptive(0, 0);
+    if (cfg.horizon_ms)
+        tw.horizon(std::chrono::milliseconds(cfg.horizon_ms));
+
+    std::vector<std::vector<timer::time64_t>> expected;
+    std::vector<std::vector<timer::time64_t>> fired;
+    auto add = [&](timer::time64_t due, timer::time64_t period = 0, int64_t round = 0) {
+        const auto id = expected.size();
+        expected.emplace_back();
+        fired.emplace_back();
+        for (int64_t i = 0; i < std::max<int64_t>(round, 1); ++i)
+            expected[id].push_back(due + i * period);
+        tw.add(std::chrono::milliseconds((due - tw.now() / precision_tt) * precision_tt),
+            [&, id](timer::timer_handle) { fired[id].push_back(tw.now() / precision_tt); }, nullptr,
+            std::chrono::milliseconds(period * precision_tt), round);
+    };
+
+    const auto base = tw.now() / precision_tt;
+    const auto first = (base / wheel_ticks + 1) * wheel_ticks;
+    // 每个边界两侧：最粗层一格之内、正好一格、跨一格
+    const int64_t offsets[] = {-int64_t(granule) - 1, -int64_t(granule), -1, 0, 1, int64_t(granule) - 1,
+        int64_t(granule), int64_t(granule) + 1};
+    for (int k = 0; k < rotations; ++k) {
+        for (const auto offset : offsets) {
+            if (first + k * wheel_ticks + offset > base)
+                add(first + k * wheel_ticks + offset);
+        }
+    }
+    // 随机远期，最远超过一圈以上
+    std::mt19937_64 rng(20261018);
+    for (int i = 0; i < cfg.randoms; ++i)
+        add(base + 1 + rng() % (rotations * wheel_ticks));
+    // 周期跨过边界
+    add(base + 7, wheel_ticks / 3 + 7, 3 * rotations);
+    // 回调里再 add：落在下一圈、最粗层已经走过的格子
+    {
+        const auto id = expected.size();
+        expected.emplace_back();
+        fired.emplace_back();
+        const auto due = first + 5 * granule;
+        expected[id].push_back(due + wheel_ticks - granule);
+        tw.add(std::chrono::milliseconds((due - base) * precision_tt), [&, id](timer::timer_handle) {
+            tw.add(std::chrono::milliseconds((wheel_ticks - granule) * precision_tt),
+                [&, id](timer::timer_handle) { fired[id].push_back(tw.now() / precision_tt); });
+        });
+    }
+
+    // 步长随机，停在各种位置上
+    const auto end = first + rotations * wheel_ticks + 2 * granule;
+    while (tw.now() / precision_tt < end) {
+        const auto step = 1 + rng() % (granule * 3);
+        tw.advance_to(std::min(tw.now() / precision_tt + step, end) * precision_tt);
+    }
+
+    int errors = 0;
+    for (std::size_t id = 0; id < expected.size(); ++id) {
+        if (fired[id] == expected[id])
+            continue;
+        if (errors++ < 5)
+            std::printf("  timer %zu: expected %zu fires from tick %llu, got %zu from tick %llu\n", id,
+                expected[id].size(), static_cast<unsigned long long>(expected[id].front()), fired[id].size(),
+                static_cast<unsigned long long>(fired[id].empty() ? 0 : fired[id].front()));
+    }
+    std::printf("%-3llu %-16s %zu timers, %d mismatched\n", static_cast<unsigned long long>(precision_tt), cfg.name,
+        expected.size(), errors);
+    return errors;
+}
+
+int main() {
+    const config configs[] = {
+        {"sparse", false, 0, 16},
+        {"adaptive", false, 0, 2000},
+        {"dense", true, 0, 2000},
+        {"dense_horizon", true, 3600 * 1000, 2000},
+        {"sparse_horizon", false, 60 * 1000, 16},
+    };
+    int errors = 0;
+    for (const auto& cfg : configs) {
+        errors += run<1>(cfg);
+        errors += run<10>(cfg);
+    }
+    return errors ? 1 : 0;
+}
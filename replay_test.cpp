@@ -0,0 +1,193 @@
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "timer_wheel.h"
+
+// 负载回放：把 timer_wheel::trace_save 导出的 trace 在 virtual_time 下按原样的 add / stop 时序重放
+// 环境变量 TIMER_TRACE 指定 trace 文件；没有时用下面的 record_sample() 现录一段类游戏负载
+// 比较不同 precision / 布局在同一负载下的耗时，以及回放触发数和原始触发数
+
+template <uint64_t precision_tt>
+using replay_timer = timer::timer_wheel<precision_tt, timer::empty_mutex, timer::alert_default,
+    timer::metrics_empty, timer::virtual_time>;
+
+struct workload_trace {
+    timer::trace_header header;
+    std::vector<timer::trace_record> records;
+    uint32_t max_id = 0;
+    uint64_t recorded_fires = 0;
+};
+
+static bool parse_trace(const std::vector<unsigned char>& data, workload_trace& trace) {
+    if (data.size() < sizeof(timer::trace_header))
+        return false;
+    std::memcpy(&trace.header, data.data(), sizeof(timer::trace_header));
+    const timer::trace_header expected;
+    // version 1 的记录只有前半截，调度选项留默认值
+    const std::size_t record_size = trace.header._version == 1 ? timer::trace_record_v1 : sizeof(timer::trace_record);
+    if (trace.header._magic != expected._magic || trace.header._version < 1 ||
+        trace.header._version > expected._version || trace.header._record_size != record_size ||
+        (data.size() - sizeof(timer::trace_header)) / record_size < trace.header._count)
+        return false;
+
+    trace.records.resize(trace.header._count);
+    for (std::size_t i = 0; i < trace.records.size(); ++i)
+        std::memcpy(&trace.records[i], data.data() + sizeof(timer::trace_header) + i * record_size, record_size);
+    for (const auto& record : trace.records) {
+        trace.max_id = std::max(trace.max_id, record._id);
+        trace.recorded_fires += record._op == timer::trace_op::fire;
+    }
+    return true;
+}
+
+static bool load_trace(const std::string& path, workload_trace& trace) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    std::vector<unsigned char> data;
+    unsigned char buffer[1 << 16];
+    std::size_t n = 0;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + n);
+    std::fclose(file);
+    return parse_trace(data, trace);
+}
+
+// 类游戏负载：打散的常驻心跳、带容差的同档位 buff、经常被打断的技能冷却、fixed_rate 的短周期 DoT，持续 60s 虚拟时间
+static workload_trace record_sample() {
+    replay_timer<1> tw(timer::virtual_time(1000000));
+    tw.trace_on(1 << 20);
+
+    std::mt19937 rng(12345);
+    auto pick = [&rng](uint32_t n) { return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng); };
+    auto dummy = [](timer::timer_handle) {};
+    const uint32_t buff_tiers[] = {3000, 5000, 10000, 15000, 30000};
+
+    timer::timer_options heartbeat;
+    heartbeat._spread = std::chrono::milliseconds(200);
+    timer::timer_options buff;
+    buff._slack = std::chrono::milliseconds(50);
+    buff._resolution = std::chrono::milliseconds(100);
+    timer::timer_options dot;
+    dot._period_mode = timer::period_mode::fixed_rate;
+    dot._catch_up = timer::catch_up_policy::burst;
+    dot._burst_limit = 3;
+
+    for (int i = 0; i < 500; i++)
+        tw.add(std::chrono::milliseconds(pick(1000)), dummy, heartbeat, nullptr, std::chrono::milliseconds(1000), -1);
+
+    std::vector<timer::timer_handle> cooldowns;
+    for (int step = 0; step < 6000; step++) {
+        for (int i = 0; i < 8; i++)
+            tw.add(std::chrono::milliseconds(buff_tiers[pick(5)]), dummy, buff);
+        for (int i = 0; i < 12; i++)
+            cooldowns.push_back(tw.add(std::chrono::milliseconds(500 + pick(7500)), dummy));
+        for (int i = 0; i < 4 && !cooldowns.empty(); i++) {
+            const auto at = pick(static_cast<uint32_t>(cooldowns.size()));
+            tw.stop(cooldowns[at]);
+            cooldowns[at] = cooldowns.back();
+            cooldowns.pop_back();
+        }
+        if (step % 5 == 0)
+            tw.add(std::chrono::milliseconds(500), dummy, dot, nullptr, std::chrono::milliseconds(500), 6);
+        tw.advance(std::chrono::milliseconds(10));
+    }
+
+    std::vector<unsigned char> data;
+    tw.trace_save(data);
+    workload_trace trace;
+    parse_trace(data, trace);
+    return trace;
+}
+
+static const workload_trace& sample_trace() {
+    static const workload_trace trace = []() {
+        workload_trace result;
+        const char* path = std::getenv("TIMER_TRACE");
+        if (path != nullptr && load_trace(path, result))
+            return result;
+        return record_sample();
+    }();
+    return trace;
+}
+
+// 记录里的调度选项还原成 timer_options：slack / resolution / 打散 / fixed_rate 的追赶策略
+static void apply_options(const timer::trace_record& record, timer::timer_options& options) {
+    options._lane = static_cast<timer::timer_lane>(record._lane);
+    options._slack = std::chrono::milliseconds(record._spread ? 0 : record._slack);
+    options._resolution = std::chrono::milliseconds(record._resolution);
+    options._spread = std::chrono::milliseconds(record._spread ? record._slack : 0);
+    options._spread_mode = static_cast<timer::spread_mode>(record._spread);
+    options._period_mode = record._rate ? timer::period_mode::fixed_rate : timer::period_mode::fixed_delay;
+    // _rate = 1 + 追赶上限：0 为 skip，1 为 once，更多为 burst
+    if (record._rate == 1) {
+        options._catch_up = timer::catch_up_policy::skip;
+    } else if (record._rate == 2) {
+        options._catch_up = timer::catch_up_policy::once;
+    } else if (record._rate > 2) {
+        options._catch_up = timer::catch_up_policy::burst;
+        options._burst_limit = static_cast<uint8_t>(record._rate - 1);
+    }
+}
+
+// 按 trace 顺序推进虚拟时间并重放 add / stop，带上记录的调度选项；
+// cron 的重排没有 period 可用，按记录的下次到期补一个单次定时器
+template <class timer_tt>
+static uint64_t replay(const workload_trace& trace, timer_tt& tw) {
+    uint64_t fired = 0;
+    auto count = [&fired](timer::timer_handle) { fired += 1; };
+    std::vector<timer::timer_handle> live(trace.max_id + 1, timer::handle_gen::invalid_handle);
+    timer::timer_options options;
+
+    for (const auto& record : trace.records) {
+        tw.advance_to(trace.header._start + record._at);
+        switch (record._op) {
+            case timer::trace_op::add: {
+                apply_options(record, options);
+                const int64_t round = record._round == UINT32_MAX ? -1 : record._round;
+                live[record._id] = tw.add(std::chrono::milliseconds(record._duration), count, options, nullptr,
+                    std::chrono::milliseconds(record._period), round);
+                break;
+            }
+            case timer::trace_op::stop:
+                tw.stop(live[record._id]);
+                live[record._id] = timer::handle_gen::invalid_handle;
+                break;
+            case timer::trace_op::reschedule:
+                if (record._kind == timer::event_kind::crontab)
+                    live[record._id] = tw.add(std::chrono::milliseconds(record._duration), count);
+                break;
+            case timer::trace_op::fire:
+                break;
+        }
+    }
+    return fired;
+}
+
+// layout: 0 默认（少量定时器时走小根堆），1 始终用时间轮
+template <uint64_t precision_tt>
+static void BM_replay_trace(benchmark::State& state) {
+    const auto& trace = sample_trace();
+    uint64_t fired = 0;
+    for (auto _ : state) {
+        auto tw = std::make_unique<replay_timer<precision_tt>>(timer::virtual_time(trace.header._start));
+        if (state.range(0) == 1)
+            tw->adaptive(0, 0);
+        fired = replay(trace, *tw);
+        benchmark::DoNotOptimize(tw);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * trace.records.size()));
+    state.counters["records"] = static_cast<double>(trace.records.size());
+    state.counters["fired"] = static_cast<double>(fired);
+    state.counters["recorded_fires"] = static_cast<double>(trace.recorded_fires);
+}
+
+#define REPLAY_BENCHMARK(precision) \
+    BENCHMARK_TEMPLATE(BM_replay_trace, precision)->ArgName("layout")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)
+
+REPLAY_BENCHMARK(1);
+REPLAY_BENCHMARK(10);
+REPLAY_BENCHMARK(50);
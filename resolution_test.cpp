@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "timer_wheel.h"
+
+// 分辨率回归：timer_options::_resolution 向下取到不超过它的层格子（1/16/256/4096/... 个 tick），
+// 到期时间向上对齐到该格子，直接在那一层触发，不再级联到更细的层
+// virtual_time 下逐个核对触发 tick 的对齐、推迟量和各层的级联次数
+// g++ -std=c++17 -O2 resolution_test.cpp && ./a.out
+
+template <uint64_t precision_tt>
+using virtual_timer = timer::timer_wheel<precision_tt, timer::empty_mutex, timer::alert_default,
+    timer::metrics_atomic, timer::virtual_time>;
+
+struct resolution_class {
+    int64_t resolution_ms;
+    timer::time64_t granule;  // 期望对齐到的 tick 数
+};
+
+template <uint64_t precision_tt>
+static int run(const resolution_class& cls) {
+    // 起点故意不对齐
+    virtual_timer<precision_tt> tw{timer::virtual_time(1000003 * precision_tt)};
+    tw.adaptive(0, 0);
+    timer::timer_options options;
+    options._resolution = std::chrono::milliseconds(cls.resolution_ms);
+
+    std::mt19937_64 rng(20261018);
+    std::vector<timer::time64_t> due;
+    std::vector<timer::time64_t> fired;
+    for (int i = 0; i < 2000; ++i) {
+        const auto delay = 1 + rng() % 200000;
+        const auto id = due.size();
+        due.push_back(tw.now() / precision_tt + delay);
+        fired.push_back(0);
+        tw.add(std::chrono::milliseconds(delay * precision_tt),
+            [&, id](timer::timer_handle) { fired[id] = tw.now() / precision_tt; }, options);
+    }
+    tw.advance(std::chrono::milliseconds((200000 + cls.granule) * precision_tt));
+
+    int errors = 0;
+    for (std::size_t id = 0; id < due.size(); ++id) {
+        if (fired[id] >= due[id] && fired[id] - due[id] < cls.granule && fired[id] % cls.granule == 0)
+            continue;
+        if (errors++ < 5)
+            std::printf("  timer %zu: due %llu, fired %llu\n", id, static_cast<unsigned long long>(due[id]),
+                static_cast<unsigned long long>(fired[id]));
+    }
+    // 对齐到第 level 层的格子后，比它细的层不会有级联
+    const auto metrics = tw.metrics().snapshot();
+    std::size_t level = timer::level_count - 1;
+    while (level > 0 && (timer::time64_t(1) << timer::level_shifts[timer::level_count - 1 - level]) < cls.granule)
+        level -= 1;
+    for (auto finer = level; finer < timer::level_count; ++finer) {
+        if (metrics.cascades[finer] == 0)
+            continue;
+        errors += 1;
+        std::printf("  %llu cascades out of level %zu\n", static_cast<unsigned long long>(metrics.cascades[finer]),
+            finer);
+    }
+    std::printf("%-3llu %5lldms -> %-5llu ticks  %d mismatched\n", static_cast<unsigned long long>(precision_tt),
+        static_cast<long long>(cls.resolution_ms), static_cast<unsigned long long>(cls.granule), errors);
+    return errors;
+}
+
+int main() {
+    int errors = 0;
+    // precision 1：10ms 不到一个 _4 格子（16 tick），等于不对齐；1s 对齐到 256 tick
+    const resolution_class fine[] = {{1, 1}, {10, 1}, {16, 16}, {100, 16}, {1000, 256}, {5000, 4096}};
+    for (const auto& cls : fine)
+        errors += run<1>(cls);
+    // precision 10：按 tick 数取格子，1s = 100 tick -> 16 tick
+    const resolution_class coarse[] = {{10, 1}, {100, 1}, {1000, 16}, {5000, 256}};
+    for (const auto& cls : coarse)
+        errors += run<10>(cls);
+    return errors ? 1 : 0;
+}
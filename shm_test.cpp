@@ -0,0 +1,349 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "timer_shm.h"
+
+// timer_shm.h 跨进程回归：service 跑在 fork 出来的子进程里，客户端在父进程（或另一个子进程）里
+// 覆盖：跨进程触发、客户端重启、service 重启（SIGKILL 后接管）、到期环溢出、到期前 stop、触发与回收交错
+// g++ -std=c++17 -O2 shm_test.cpp -lpthread && ./a.out
+
+#if defined(__linux__)
+#include <sys/wait.h>
+
+using timer::time64_t;
+using timer::timer_handle;
+using timer::handle_gen;
+using timer::shm::segment;
+using timer::shm::shm_client;
+using timer::shm::shm_service;
+
+struct spawn_payload {
+    uint32_t id;
+    uint32_t zone;
+};
+
+static const std::string segment_name = "/tw_shm_test_" + std::to_string(getpid());
+static constexpr uint32_t clients = 2;
+static constexpr uint32_t per_client = 8192;
+static int failures = 0;
+
+#define CHECK(cond)                                                                \
+    do {                                                                           \
+        if (!(cond)) {                                                             \
+            std::printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures += 1;                                                         \
+        }                                                                          \
+    } while (0)
+
+// 子进程里驱动 service，直到被 kill
+static pid_t start_service() {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        auto service = shm_service<1>::create(segment_name, clients, per_client);
+        if (service == nullptr)
+            _exit(1);
+        while (true) {
+            service->execute();
+            service->wait(timer::time_duration(1));
+        }
+    }
+    return pid;
+}
+
+// SIGKILL 模拟崩溃；回收僵尸进程后新的 service 才能接管
+static void kill_service(pid_t pid) {
+    kill(pid, SIGKILL);
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+static std::unique_ptr<shm_client> attach(uint32_t id) {
+    for (int i = 0; i < 200; ++i) {
+        auto client = shm_client::attach(segment_name, id);
+        if (client)
+            return client;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return nullptr;
+}
+
+template <class done_tt>
+static bool pump(shm_client& client, time64_t timeout_ms, done_tt&& done) {
+    const auto deadline = timer::tick() + timeout_ms;
+    while (!done()) {
+        if (timer::tick() >= deadline)
+            return false;
+        client.wait(timer::time_duration(20));
+        client.drain();
+    }
+    return true;
+}
+
+static void cross_process_fire() {
+    const auto service = start_service();
+    auto client = attach(0);
+    CHECK(client != nullptr);
+    if (client) {
+        std::vector<std::pair<uint32_t, time64_t>> fired;
+        client->register_type<spawn_payload>(
+            1, [&](timer_handle, const spawn_payload& value) { fired.push_back({value.id, timer::tick()}); });
+        const auto due = timer::tick() + 30;
+        CHECK(client->add(std::chrono::milliseconds(30), 1, spawn_payload{7, 1}) != handle_gen::invalid_handle);
+        CHECK(client->add(std::chrono::milliseconds(10), 1, spawn_payload{8, 1}, std::chrono::milliseconds(10), 3) !=
+              handle_gen::invalid_handle);
+        CHECK(pump(*client, 1000, [&]() { return fired.size() == 4; }));
+        std::size_t once = 0, periodic = 0;
+        for (const auto& [id, at] : fired) {
+            once += id == 7;
+            periodic += id == 8;
+            if (id == 7)
+                CHECK(at >= due);
+        }
+        CHECK(once == 1 && periodic == 3);
+    }
+    client.reset();
+    kill_service(service);
+}
+
+static void client_restart() {
+    const auto service = start_service();
+    const pid_t child = fork();
+    if (child == 0) {
+        auto client = attach(1);
+        if (client == nullptr)
+            _exit(1);
+        client->add(std::chrono::milliseconds(50), 1, spawn_payload{42, 2});
+        _exit(0);  // 不 drain 直接退出，通知留在到期环里
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    auto client = attach(1);
+    CHECK(client != nullptr);
+    if (client) {
+        CHECK(shm_client::attach(segment_name, 1) == nullptr);  // 同一 id 已被本进程占用
+        int got = 0;
+        client->register_type<spawn_payload>(1, [&](timer_handle, const spawn_payload& value) { got += value.id == 42; });
+        CHECK(pump(*client, 1000, [&]() { return got > 0; }));
+        CHECK(got == 1);
+    }
+    client.reset();
+    kill_service(service);
+}
+
+static void service_restart() {
+    auto service = start_service();
+    auto client = attach(0);
+    CHECK(client != nullptr);
+    if (client == nullptr) {
+        kill_service(service);
+        return;
+    }
+    int got = 0;
+    client->register_type<spawn_payload>(1, [&](timer_handle, const spawn_payload& value) { got += value.id == 43; });
+    CHECK(client->add(std::chrono::milliseconds(200), 1, spawn_payload{43, 3}) != handle_gen::invalid_handle);
+    // 等 service 把它放进时间轮再杀掉
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    kill_service(service);
+    CHECK(got == 0);
+
+    service = start_service();
+    CHECK(pump(*client, 2000, [&]() { return got > 0; }));
+    CHECK(got == 1);
+    client.reset();
+    kill_service(service);
+}
+
+// 到期通知多于到期环容量：service 暂存到 backlog，客户端 drain 之后补投，每个恰好一次
+static void ring_overflow() {
+    const auto service = start_service();
+    auto client = attach(0);
+    CHECK(client != nullptr);
+    if (client) {
+        const uint32_t count = static_cast<uint32_t>(timer::shm::ring_capacity) + 2000;
+        std::vector<int> seen(count, 0);
+        client->register_type<uint32_t>(1, [&](timer_handle, const uint32_t& value) { seen[value] += 1; });
+        for (uint32_t i = 0; i < count; ++i) {
+            // 命令环满了等 service 消费
+            while (client->add(std::chrono::milliseconds(20), 1, i) == handle_gen::invalid_handle)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // 不 drain，让到期环先满
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        uint32_t delivered = 0;
+        CHECK(pump(*client, 3000, [&]() {
+            delivered = 0;
+            for (const auto value : seen)
+                delivered += value > 0;
+            return delivered == count;
+        }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        client->drain();
+        std::size_t duplicated = 0;
+        for (const auto value : seen)
+            duplicated += value > 1;
+        CHECK(delivered == count);
+        CHECK(duplicated == 0);
+    }
+    client.reset();
+    kill_service(service);
+}
+
+static void stop_before_fire() {
+    const auto service = start_service();
+    auto client = attach(0);
+    CHECK(client != nullptr);
+    if (client) {
+        int stopped = 0, kept = 0;
+        client->register_type<spawn_payload>(1, [&](timer_handle, const spawn_payload& value) {
+            stopped += value.id == 1;
+            kept += value.id == 2;
+        });
+        const auto handle = client->add(std::chrono::milliseconds(50), 1, spawn_payload{1, 0});
+        CHECK(handle != handle_gen::invalid_handle);
+        CHECK(client->add(std::chrono::milliseconds(80), 1, spawn_payload{2, 0}) != handle_gen::invalid_handle);
+        CHECK(client->stop(handle).count() > 0);
+        CHECK(pump(*client, 1000, [&]() { return kept > 0; }));
+        CHECK(stopped == 0);
+        CHECK(kept == 1);
+
+        // 停掉的记录已回收：整个分区还能再放满（命令环满时等 service 消费）
+        std::vector<timer_handle> handles;
+        const auto deadline = timer::tick() + 2000;
+        while (handles.size() < per_client && timer::tick() < deadline) {
+            const auto added = client->add(std::chrono::seconds(60), 1, spawn_payload{3, 0});
+            if (added != handle_gen::invalid_handle)
+                handles.push_back(added);
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(handles.size() == per_client);
+    }
+    client.reset();
+    kill_service(service);
+}
+
+// 大量马上到期的一次性定时器，边 add 边 drain：客户端回收记录和 service 推进状态交错，
+// 每个恰好触发一次，记录回收后没有残留，分区仍能整个放满
+static void fire_reuse_stress() {
+    const auto service = start_service();
+    auto client = attach(0);
+    CHECK(client != nullptr);
+    if (client) {
+        const uint32_t count = 4 * per_client;
+        std::vector<int> seen(count, 0);
+        client->register_type<uint32_t>(1, [&](timer_handle, const uint32_t& value) { seen[value] += 1; });
+        uint32_t added = 0, fired = 0;
+        const auto deadline = timer::tick() + 10000;
+        while (fired < count && timer::tick() < deadline) {
+            // 在途的少于 64 个时补满，持续复用刚回收的记录
+            while (added < count && added - fired < 64 &&
+                   client->add(std::chrono::milliseconds(added % 3), 1, added) != handle_gen::invalid_handle)
+                added += 1;
+            // 忙等 drain，尽量贴着 service 写环的时刻回收记录
+            const auto drained = static_cast<uint32_t>(client->drain());
+            fired += drained;
+            if (drained == 0 && added == count)
+                client->wait(timer::time_duration(5));
+        }
+        std::size_t missing = 0, duplicated = 0;
+        for (const auto value : seen) {
+            missing += value == 0;
+            duplicated += value > 1;
+        }
+        CHECK(added == count);
+        CHECK(missing == 0);
+        CHECK(duplicated == 0);
+
+        std::vector<timer_handle> handles;
+        const auto refill = timer::tick() + 2000;
+        while (handles.size() < per_client && timer::tick() < refill) {
+            const auto handle = client->add(std::chrono::seconds(60), 1, uint32_t(0));
+            if (handle != handle_gen::invalid_handle)
+                handles.push_back(handle);
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(handles.size() == per_client);
+    }
+    client.reset();
+    kill_service(service);
+}
+
+int main() {
+    struct {
+        const char* name;
+        void (*run)();
+    } cases[] = {
+        {"cross_process_fire", cross_process_fire},
+        {"client_restart", client_restart},
+        {"service_restart", service_restart},
+        {"ring_overflow", ring_overflow},
+        {"stop_before_fire", stop_before_fire},
+        {"fire_reuse_stress", fire_reuse_stress},
+    };
+    for (const auto& item : cases) {
+        segment::unlink(segment_name);
+        const auto before = failures;
+        item.run();
+        std::printf("%-20s %s\n", item.name, failures == before ? "ok" : "FAILED");
+    }
+    segment::unlink(segment_name);
+    return failures ? 1 : 0;
+}
+
+#else
+// 大量马上到期的一次性定时器，边 add 边 drain：客户端回收记录和 service 推进状态交错，
+// 每个恰好触发一次，记录回收后没有残留，分区仍能整个放满
+static void fire_reuse_stress() {
+    const auto service = start_service();
+    auto client = attach(0);
+    CHECK(client != nullptr);
+    if (client) {
+        const uint32_t count = 4 * per_client;
+        std::vector<int> seen(count, 0);
+        client->register_type<uint32_t>(1, [&](timer_handle, const uint32_t& value) { seen[value] += 1; });
+        uint32_t added = 0, fired = 0;
+        const auto deadline = timer::tick() + 10000;
+        while (fired < count && timer::tick() < deadline) {
+            // 在途的少于 64 个时补满，持续复用刚回收的记录
+            while (added < count && added - fired < 64 &&
+                   client->add(std::chrono::milliseconds(added % 3), 1, added) != handle_gen::invalid_handle)
+                added += 1;
+            // 忙等 drain，尽量贴着 service 写环的时刻回收记录
+            const auto drained = static_cast<uint32_t>(client->drain());
+            fired += drained;
+            if (drained == 0 && added == count)
+                client->wait(timer::time_duration(5));
+        }
+        std::size_t missing = 0, duplicated = 0;
+        for (const auto value : seen) {
+            missing += value == 0;
+            duplicated += value > 1;
+        }
+        CHECK(added == count);
+        CHECK(missing == 0);
+        CHECK(duplicated == 0);
+
+        std::vector<timer_handle> handles;
+        const auto refill = timer::tick() + 2000;
+        while (handles.size() < per_client && timer::tick() < refill) {
+            const auto handle = client->add(std::chrono::seconds(60), 1, uint32_t(0));
+            if (handle != handle_gen::invalid_handle)
+                handles.push_back(handle);
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(handles.size() == per_client);
+    }
+    client.reset();
+    kill_service(service);
+}
+
+int main() {
+    std::printf("timer_shm.h is Linux only, skipped\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,418 @@
+#pragma once
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include "timer_wheel.h"
+
+namespace timer::reference {
+/**
+ * \brief 对照组定时器（仅用于 benchmark）
+ * 与 timer_wheel 使用相同的 event_custom 与 add/stop/execute 接口，只替换排序容器：
+ * - heap_timer:     二叉/四叉最小堆（惰性删除）
+ * - rbtree_timer:   std::multimap（红黑树，立即删除）
+ * - skiplist_timer: 跳表（立即删除）
+ * - hashed_wheel:   单层哈希时间轮（按到期时间区分圈数，惰性删除）
+ */
+
+template <uint64_t precision_tt = 10>
+class scheduler_base {
+ protected:
+  static constexpr time64_t _precision = precision_tt;  // 精度
+
+  std::unordered_map<timer_handle, std::shared_ptr<event_interface>> _events;
+  timer_handle _last_handle = 0;
+
+  time64_t _tick = tick() / _precision;
+
+  template <class Rep, class Period>
+  std::shared_ptr<event_interface> create(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
+    timer_stopped_callback &&stopped_callback, const time_duration &period, const int64_t round) {
+    std::shared_ptr<event_interface> event_ = event_custom<_precision>::create(
+      std::chrono::duration_cast<time_duration>((time_clock::now() + when).time_since_epoch()).count() / _precision,
+      period.count(), round, std::forward<timer_callback>(callback),
+      std::forward<timer_stopped_callback>(stopped_callback));
+    if (event_ == nullptr)
+      return nullptr;
+
+    if (event_->_next < _tick)
+      event_->_next = _tick;
+    event_->_handle = ++_last_handle;
+    _events.emplace(event_->_handle, event_);
+    return event_;
+  }
+
+  // 从 _events 摘除并回调 stopped，返回剩余时间
+  time_duration remove(const timer_handle &handle) {
+    const auto iter = _events.find(handle);
+    if (iter == _events.end() || iter->second == nullptr)
+      return time_duration(0);
+    auto evt = iter->second;
+    _events.erase(iter);
+
+    event_interface::stopped(evt);
+
+    const auto tick_ = tick();
+    const auto next_ = evt->_next * _precision;
+    if (next_ >= tick_)
+      return time_duration(next_ - tick_);
+    return time_duration(0);
+  }
+
+  // 与 timer_wheel::step_list 相同的触发语义，返回 true 表示需要重新入队
+  bool fire(const std::shared_ptr<event_interface> &evt) {
+    if (evt->_round) {
+      if (evt->_callback)
+        evt->_callback(evt->_handle);
+      if (_events.find(evt->_handle) == _events.end())
+        return false;
+      evt->_round -= 1;
+    }
+
+    if (evt->_round == 0ull) {
+      _events.erase(evt->_handle);
+      event_interface::stopped(evt);
+      return false;
+    }
+
+    evt->next<_precision>(tick());
+    if (evt->_next <= _tick)
+      evt->_next = _tick + 1;
+    return true;
+  }
+
+  std::shared_ptr<event_interface> find(const timer_handle &handle) const {
+    const auto iter = _events.find(handle);
+    if (iter == _events.end())
+      return nullptr;
+    return iter->second;
+  }
+
+ public:
+  std::size_t size() const {
+    return _events.size();
+  }
+};
+
+template <uint64_t precision_tt = 10, std::size_t arity_tt = 2>
+class heap_timer : public scheduler_base<precision_tt> {
+  static_assert(arity_tt >= 2, "heap arity must be >= 2");
+
+ private:
+  struct entry {
+    time64_t _next;
+    timer_handle _handle;
+  };
+  std::vector<entry> _heap;
+
+  void sift_up(std::size_t idx) {
+    entry item = _heap[idx];
+    while (idx > 0) {
+      const std::size_t parent = (idx - 1) / arity_tt;
+      if (_heap[parent]._next <= item._next)
+        break;
+      _heap[idx] = _heap[parent];
+      idx = parent;
+    }
+    _heap[idx] = item;
+  }
+
+  void sift_down(std::size_t idx) {
+    const std::size_t size = _heap.size();
+    entry item = _heap[idx];
+    while (true) {
+      const std::size_t first = idx * arity_tt + 1;
+      if (first >= size)
+        break;
+      std::size_t best = first;
+      const std::size_t last = std::min(first + arity_tt, size);
+      for (std::size_t child = first + 1; child < last; ++child) {
+        if (_heap[child]._next < _heap[best]._next)
+          best = child;
+      }
+      if (item._next <= _heap[best]._next)
+        break;
+      _heap[idx] = _heap[best];
+      idx = best;
+    }
+    _heap[idx] = item;
+  }
+
+  void push(const std::shared_ptr<event_interface> &evt) {
+    _heap.push_back({evt->_next, evt->_handle});
+    sift_up(_heap.size() - 1);
+  }
+
+  void pop() {
+    _heap.front() = _heap.back();
+    _heap.pop_back();
+    if (!_heap.empty())
+      sift_down(0);
+  }
+
+ public:
+  template <class Rep, class Period>
+  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
+    timer_stopped_callback &&stopped_callback = nullptr, const time_duration &period = time_duration::zero(),
+    const int64_t round = 0) {
+    auto evt = this->create(when, std::forward<timer_callback>(callback),
+      std::forward<timer_stopped_callback>(stopped_callback), period, round);
+    if (evt == nullptr)
+      return handle_gen::invalid_handle;
+    push(evt);
+    return evt->_handle;
+  }
+
+  inline time_duration stop(const timer_handle &handle) {
+    return this->remove(handle);  // 惰性删除：堆内条目在弹出时丢弃
+  }
+
+  inline void execute() {
+    this->_tick = tick() / this->_precision;
+    while (!_heap.empty() && _heap.front()._next <= this->_tick) {
+      const entry top = _heap.front();
+      pop();
+
+      auto evt = this->find(top._handle);
+      if (evt == nullptr || evt->_next != top._next)
+        continue;
+      if (this->fire(evt))
+        push(evt);
+    }
+  }
+};
+
+template <uint64_t precision_tt = 10>
+class rbtree_timer : public scheduler_base<precision_tt> {
+ private:
+  std::multimap<time64_t, timer_handle> _tree;
+  std::unordered_map<timer_handle, typename std::multimap<time64_t, timer_handle>::iterator> _nodes;
+
+  void push(const std::shared_ptr<event_interface> &evt) {
+    _nodes[evt->_handle] = _tree.emplace(evt->_next, evt->_handle);
+  }
+
+ public:
+  template <class Rep, class Period>
+  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
+    timer_stopped_callback &&stopped_callback = nullptr, const time_duration &period = time_duration::zero(),
+    const int64_t round = 0) {
+    auto evt = this->create(when, std::forward<timer_callback>(callback),
+      std::forward<timer_stopped_callback>(stopped_callback), period, round);
+    if (evt == nullptr)
+      return handle_gen::invalid_handle;
+    push(evt);
+    return evt->_handle;
+  }
+
+  inline time_duration stop(const timer_handle &handle) {
+    const auto iter = _nodes.find(handle);
+    if (iter != _nodes.end()) {
+      _tree.erase(iter->second);
+      _nodes.erase(iter);
+    }
+    return this->remove(handle);
+  }
+
+  inline void execute() {
+    this->_tick = tick() / this->_precision;
+    while (!_tree.empty() && _tree.begin()->first <= this->_tick) {
+      const timer_handle handle = _tree.begin()->second;
+      _tree.erase(_tree.begin());
+      _nodes.erase(handle);
+
+      auto evt = this->find(handle);
+      if (evt == nullptr)
+        continue;
+      if (this->fire(evt))
+        push(evt);
+    }
+  }
+};
+
+template <uint64_t precision_tt = 10, std::size_t max_level_tt = 16>
+class skiplist_timer : public scheduler_base<precision_tt> {
+ private:
+  struct node {
+    time64_t _next = 0;
+    timer_handle _handle = handle_gen::invalid_handle;
+    std::vector<node *> _forward;
+
+    node(time64_t nxt, timer_handle handle, std::size_t level) : _next(nxt), _handle(handle), _forward(level, nullptr) {}
+  };
+
+  node _head{0, handle_gen::invalid_handle, max_level_tt};
+  std::size_t _level = 1;
+  std::minstd_rand _rand{20240728};
+  std::unordered_map<timer_handle, time64_t> _keys;  // handle -> 入表时的 _next
+
+  static bool less(const node *lhs, time64_t nxt, timer_handle handle) {
+    return lhs->_next < nxt || (lhs->_next == nxt && lhs->_handle < handle);
+  }
+
+  std::size_t random_level() {
+    std::size_t level = 1;
+    while (level < max_level_tt && (_rand() & 3) == 0)
+      ++level;
+    return level;
+  }
+
+  void insert(time64_t nxt, timer_handle handle) {
+    std::array<node *, max_level_tt> update;
+    node *cur = &_head;
+    for (std::size_t i = _level; i-- > 0;) {
+      while (cur->_forward[i] && less(cur->_forward[i], nxt, handle))
+        cur = cur->_forward[i];
+      update[i] = cur;
+    }
+
+    const std::size_t level = random_level();
+    if (level > _level) {
+      for (std::size_t i = _level; i < level; ++i)
+        update[i] = &_head;
+      _level = level;
+    }
+
+    node *item = new node(nxt, handle, level);
+    for (std::size_t i = 0; i < level; ++i) {
+      item->_forward[i] = update[i]->_forward[i];
+      update[i]->_forward[i] = item;
+    }
+    _keys[handle] = nxt;
+  }
+
+  void erase(time64_t nxt, timer_handle handle) {
+    std::array<node *, max_level_tt> update;
+    node *cur = &_head;
+    for (std::size_t i = _level; i-- > 0;) {
+      while (cur->_forward[i] && less(cur->_forward[i], nxt, handle))
+        cur = cur->_forward[i];
+      update[i] = cur;
+    }
+
+    node *item = cur->_forward[0];
+    if (item == nullptr || item->_next != nxt || item->_handle != handle)
+      return;
+
+    for (std::size_t i = 0; i < _level && update[i]->_forward[i] == item; ++i)
+      update[i]->_forward[i] = item->_forward[i];
+    while (_level > 1 && _head._forward[_level - 1] == nullptr)
+      --_level;
+    _keys.erase(handle);
+    delete item;
+  }
+
+ public:
+  skiplist_timer() = default;
+  skiplist_timer(const skiplist_timer &) = delete;
+  skiplist_timer &operator=(const skiplist_timer &) = delete;
+
+  ~skiplist_timer() {
+    node *cur = _head._forward[0];
+    while (cur) {
+      node *nxt = cur->_forward[0];
+      delete cur;
+      cur = nxt;
+    }
+  }
+
+  template <class Rep, class Period>
+  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
+    timer_stopped_callback &&stopped_callback = nullptr, const time_duration &period = time_duration::zero(),
+    const int64_t round = 0) {
+    auto evt = this->create(when, std::forward<timer_callback>(callback),
+      std::forward<timer_stopped_callback>(stopped_callback), period, round);
+    if (evt == nullptr)
+      return handle_gen::invalid_handle;
+    insert(evt->_next, evt->_handle);
+    return evt->_handle;
+  }
+
+  inline time_duration stop(const timer_handle &handle) {
+    const auto iter = _keys.find(handle);
+    if (iter != _keys.end())
+      erase(iter->second, handle);
+    return this->remove(handle);
+  }
+
+  inline void execute() {
+    this->_tick = tick() / this->_precision;
+    while (_head._forward[0] && _head._forward[0]->_next <= this->_tick) {
+      const time64_t nxt = _head._forward[0]->_next;
+      const timer_handle handle = _head._forward[0]->_handle;
+      erase(nxt, handle);
+
+      auto evt = this->find(handle);
+      if (evt == nullptr)
+        continue;
+      if (this->fire(evt))
+        insert(evt->_next, evt->_handle);
+    }
+  }
+};
+
+template <uint64_t precision_tt = 10, std::size_t slot_bits_tt = 9>
+class hashed_wheel : public scheduler_base<precision_tt> {
+ private:
+  static constexpr time64_t _slot_count = 1ull << slot_bits_tt;
+  static constexpr time64_t _slot_mask = _slot_count - 1;
+
+  struct entry {
+    time64_t _next;
+    timer_handle _handle;
+  };
+  std::vector<std::vector<entry>> _slots = std::vector<std::vector<entry>>(_slot_count);
+
+  void push(const std::shared_ptr<event_interface> &evt) {
+    _slots[evt->_next & _slot_mask].push_back({evt->_next, evt->_handle});
+  }
+
+ public:
+  template <class Rep, class Period>
+  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
+    timer_stopped_callback &&stopped_callback = nullptr, const time_duration &period = time_duration::zero(),
+    const int64_t round = 0) {
+    auto evt = this->create(when, std::forward<timer_callback>(callback),
+      std::forward<timer_stopped_callback>(stopped_callback), period, round);
+    if (evt == nullptr)
+      return handle_gen::invalid_handle;
+    push(evt);
+    return evt->_handle;
+  }
+
+  inline time_duration stop(const timer_handle &handle) {
+    return this->remove(handle);  // 惰性删除：槽内条目在扫描时丢弃
+  }
+
+  inline void execute() {
+    const auto tick_now = tick() / this->_precision;
+
+    while (this->_tick <= tick_now) {
+      auto &slot = _slots[this->_tick & _slot_mask];
+      std::vector<std::shared_ptr<event_interface>> due;
+      for (std::size_t i = 0; i < slot.size();) {
+        // 未到期（后续圈数）的条目保留，其余摘出
+        if (slot[i]._next > this->_tick) {
+          ++i;
+          continue;
+        }
+        auto evt = this->find(slot[i]._handle);
+        if (evt && evt->_next == slot[i]._next)
+          due.push_back(std::move(evt));
+        slot[i] = slot.back();
+        slot.pop_back();
+      }
+
+      for (const auto &evt : due) {
+        if (this->fire(evt))
+          push(evt);
+      }
+
+      if (this->_tick == tick_now)
+        break;
+      this->_tick += 1;
+    }
+  }
+};
+
+};  // end namespace timer::reference
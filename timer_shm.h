@@ -0,0 +1,658 @@
+#pragma once
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <ctime>
+
+#include "timer_wheel.h"
+
+namespace timer {
+namespace shm {
+/**
+ * \brief 同机多进程共享的定时器服务
+ * 一个 POSIX 共享内存段里放：段头、每个客户端一对环（命令环 client -> service，到期环 service -> client）、定时器记录表
+ * 段内只存下标和相对段首的偏移，不存指针，各进程映射到任意地址都可以用
+ * 记录表是权威状态：service 进程用自己的 timer_wheel 给记录做索引，重启后扫一遍记录表重建；客户端重启后重新 attach，
+ * 名下的定时器照常触发，到期通知留在到期环里等它 drain
+ *
+ * 记录表按客户端分区，客户端只在自己的分区里分配记录，不和其他进程竞争
+ * 记录状态：free -> pending（客户端写好字段，发 arm 命令）-> armed（service 放进时间轮）
+ *   -> fired（最后一次到期已投递，等客户端 drain 后置回 free）；cancel 由 service 置回 free
+ * 到期通知至少投递一次：周期定时器在通知写入到期环之后才推进轮次；最后一次先置 fired 再写环，
+ * 客户端 drain 时只把 fired 换回 free，service 之后不再碰这条记录。中途崩溃重启时 fired 的记录再投递一次
+ *
+ * 每个 shm_client 对象只能在一个线程里使用（它是命令环唯一的生产者、到期环唯一的消费者）
+ */
+
+static constexpr uint32_t segment_magic = 0x4D535754;  // "TWSM"
+static constexpr uint16_t segment_version = 1;
+static constexpr std::size_t ring_capacity = 4096;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+  "futex needs a plain 32-bit atomic");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock free");
+
+enum class record_state : uint32_t {
+  free = 0,
+  pending = 1,  // 已分配，arm 命令未处理
+  armed = 2,    // 在 service 的时间轮里
+  fired = 3,    // 最后一次到期已投递，等客户端 drain
+};
+
+struct record {
+  std::atomic<uint32_t> _state = 0;  // record_state
+  uint32_t _generation = 0;          // 客户端分配时 +1，和下标一起组成句柄
+  uint32_t _type = 0;                // 回调类型 id（客户端 register_type）
+  uint32_t _size = 0;                // payload 字节数
+  std::atomic<time64_t> _next = 0;   // 绝对到期时间（ms），周期定时器由 service 更新
+  time64_t _period = 0;              // 间隔（ms）
+  std::atomic<uint64_t> _round = 0;  // 剩余轮次
+  unsigned char _payload[payload_capacity] = {};
+};
+
+enum class command_op : uint32_t {
+  arm = 1,
+  cancel = 2,
+};
+
+struct command {
+  command_op _op = command_op::arm;
+  uint32_t _index = 0;  // 全局记录下标
+  uint32_t _generation = 0;
+  uint32_t _reserved = 0;
+};
+
+struct expiry {
+  timer_handle _handle = handle_gen::invalid_handle;
+  uint32_t _last = 0;  // 最后一次到期，客户端回调后回收记录
+  uint32_t _reserved = 0;
+};
+
+/**
+ * \brief 段内的单生产者单消费者环
+ * 和 spsc_ring 一样生产者只写尾、消费者只写头，但没有本地未发布的尾：段内状态要能在任一方崩溃后被另一方接着用
+ */
+template <class value_tt, std::size_t capacity_tt>
+struct ring {
+  static_assert((capacity_tt & (capacity_tt - 1)) == 0, "capacity must be a power of two");
+  static_assert(std::is_trivially_copyable_v<value_tt>, "ring items live in shared memory");
+
+  alignas(64) std::atomic<uint64_t> _head = 0;  // 消费者已取到的位置
+  alignas(64) std::atomic<uint64_t> _tail = 0;  // 生产者已发布的位置
+  alignas(64) value_tt _items[capacity_tt];
+
+  // 满时返回 false
+  bool push(const value_tt &value) {
+    const auto tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == capacity_tt)
+      return false;
+    _items[tail & (capacity_tt - 1)] = value;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+  }
+
+  // 消费者：最多取 limit 个，返回处理个数
+  template <class fn_tt>
+  std::size_t drain(fn_tt &&fn, std::size_t limit) {
+    auto head = _head.load(std::memory_order_relaxed);
+    const auto tail = _tail.load(std::memory_order_acquire);
+    std::size_t count = 0;
+    while (head != tail && count < limit) {
+      const value_tt value = _items[head & (capacity_tt - 1)];
+      head += 1;
+      count += 1;
+      // 先归还位置，回调里可以再 push
+      _head.store(head, std::memory_order_release);
+      fn(value);
+    }
+    return count;
+  }
+};
+
+/**
+ * \brief 跨进程门铃（futex）
+ * 等待方先登记再检查条件，生产方发布之后 +1 并只在有人等待时 FUTEX_WAKE，没人睡的时候不进内核
+ */
+struct doorbell {
+  std::atomic<uint32_t> _sequence = 0;
+  std::atomic<uint32_t> _waiters = 0;
+
+  void ring() {
+    _sequence.fetch_add(1, std::memory_order_seq_cst);
+    if (_waiters.load(std::memory_order_seq_cst) != 0)
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(&_sequence), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+  }
+
+  // ready 返回 true 时不睡；返回是否在超时前被唤醒或 ready
+  template <class ready_tt>
+  bool wait(ready_tt &&ready, time_duration timeout) {
+    const auto sequence = _sequence.load(std::memory_order_seq_cst);
+    _waiters.fetch_add(1, std::memory_order_seq_cst);
+    bool woken = true;
+    if (!ready()) {
+      timespec ts{static_cast<time_t>(timeout.count() / 1000), static_cast<long>(timeout.count() % 1000) * 1000000};
+      woken = syscall(SYS_futex, reinterpret_cast<uint32_t *>(&_sequence), FUTEX_WAIT, sequence, &ts, nullptr, 0) ==
+                0 ||
+              errno != ETIMEDOUT;
+    }
+    _waiters.fetch_sub(1, std::memory_order_seq_cst);
+    return woken;
+  }
+};
+
+struct client_block {
+  std::atomic<int32_t> _pid = 0;  // attach 的进程，0 表示没有
+  doorbell _bell;                 // 到期环有新通知
+  ring<command, ring_capacity> _commands;
+  ring<expiry, ring_capacity> _expired;
+};
+
+// 段头：各区域按偏移定位
+struct segment_header {
+  uint32_t _magic = segment_magic;
+  uint16_t _version = segment_version;
+  uint16_t _record_size = sizeof(record);
+  uint32_t _clients = 0;     // 客户端个数
+  uint32_t _per_client = 0;  // 每个客户端的记录数
+  uint64_t _clients_offset = 0;
+  uint64_t _records_offset = 0;
+  uint64_t _size = 0;               // 整段字节数
+  std::atomic<int32_t> _owner = 0;  // service 进程
+  std::atomic<uint32_t> _ready = 0;
+  doorbell _bell;  // 命令环有新命令
+};
+
+// 该 pid 的进程是否还活着
+inline bool alive(int32_t pid) {
+  return pid != 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// 占住一个 pid 槽位：空的或原进程已退出时成功（同一进程也不能占两次）
+inline bool claim(std::atomic<int32_t> &slot) {
+  const auto self = static_cast<int32_t>(getpid());
+  auto current = slot.load(std::memory_order_acquire);
+  while (!alive(current)) {
+    if (slot.compare_exchange_weak(current, self, std::memory_order_acq_rel))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * \brief 共享内存映射（RAII，析构只 munmap，不删除段）
+ */
+class segment {
+ private:
+  void *_base = nullptr;
+  std::size_t _size = 0;
+
+  segment(void *base, std::size_t size) : _base(base), _size(size) {}
+
+ public:
+  segment(const segment &) = delete;
+  segment &operator=(const segment &) = delete;
+
+  ~segment() {
+    if (_base)
+      munmap(_base, _size);
+  }
+
+  static std::size_t layout(uint32_t clients, uint32_t per_client, segment_header *header = nullptr) {
+    auto align = [](std::size_t offset) { return (offset + 63) & ~std::size_t(63); };
+    const std::size_t clients_offset = align(sizeof(segment_header));
+    const std::size_t records_offset = align(clients_offset + sizeof(client_block) * clients);
+    const std::size_t size = records_offset + sizeof(record) * clients * per_client;
+    if (header) {
+      header->_clients = clients;
+      header->_per_client = per_client;
+      header->_clients_offset = clients_offset;
+      header->_records_offset = records_offset;
+      header->_size = size;
+    }
+    return size;
+  }
+
+  /**
+   * \brief 创建或打开段；clients 为 0 表示只打开已有段（客户端）
+   * 已有段的几何参数和要求的不一致时返回 nullptr
+   */
+  static std::unique_ptr<segment> open(const std::string &name, uint32_t clients = 0, uint32_t per_client = 0) {
+    const bool create = clients != 0;
+    const int fd = shm_open(name.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0600);
+    if (fd < 0)
+      return nullptr;
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return nullptr;
+    }
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    const bool fresh = size == 0;
+    if (fresh) {
+      if (!create || ftruncate(fd, static_cast<off_t>(layout(clients, per_client))) != 0) {
+        close(fd);
+        return nullptr;
+      }
+      size = layout(clients, per_client);
+    }
+
+    void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+      return nullptr;
+    std::unique_ptr<segment> result(new segment(base, size));
+
+    auto *header = static_cast<segment_header *>(base);
+    if (fresh) {
+      // ftruncate 出来的段全零，这里只需构造段头和各客户端块
+      new (header) segment_header();
+      layout(clients, per_client, header);
+      for (uint32_t i = 0; i < clients; ++i)
+        new (result->client(i)) client_block();
+      header->_ready.store(1, std::memory_order_release);
+      return result;
+    }
+
+    if (size < sizeof(segment_header) || header->_ready.load(std::memory_order_acquire) == 0 ||
+        header->_magic != segment_magic || header->_version != segment_version ||
+        header->_record_size != sizeof(record) || header->_size != size)
+      return nullptr;
+    if (create && (header->_clients != clients || header->_per_client != per_client))
+      return nullptr;
+    return result;
+  }
+
+  static bool unlink(const std::string &name) {
+    return shm_unlink(name.c_str()) == 0;
+  }
+
+  segment_header &header() const {
+    return *static_cast<segment_header *>(_base);
+  }
+
+  client_block *client(uint32_t id) const {
+    auto *bytes = static_cast<unsigned char *>(_base) + header()._clients_offset;
+    return reinterpret_cast<client_block *>(bytes) + id;
+  }
+
+  record &at(uint32_t index) const {
+    auto *bytes = static_cast<unsigned char *>(_base) + header()._records_offset;
+    return reinterpret_cast<record *>(bytes)[index];
+  }
+
+  uint32_t capacity() const {
+    return header()._clients * header()._per_client;
+  }
+};
+
+/**
+ * \brief 客户端：在自己的记录分区里分配定时器，经命令环交给 service，从到期环取通知并按类型回调
+ */
+class shm_client {
+ private:
+  std::unique_ptr<segment> _segment;
+  client_block *_block = nullptr;
+  uint32_t _id = 0;
+  uint32_t _first = 0;   // 分区首个记录的全局下标
+  uint32_t _count = 0;   // 分区记录数
+  uint32_t _cursor = 0;  // 下次分配从这里开始扫
+  std::vector<typed_callback> _typed;
+
+  shm_client(std::unique_ptr<segment> &&seg, uint32_t id)
+      : _segment(std::move(seg)), _block(_segment->client(id)), _id(id),
+        _first(id * _segment->header()._per_client), _count(_segment->header()._per_client) {}
+
+  // 按时钟扫分区找 free 记录，找不到返回 nullptr
+  record *allocate(uint32_t &index) {
+    for (uint32_t i = 0; i < _count; ++i) {
+      const uint32_t local = (_cursor + i) % _count;
+      record &rec = _segment->at(_first + local);
+      if (rec._state.load(std::memory_order_acquire) != static_cast<uint32_t>(record_state::free))
+        continue;
+      _cursor = (local + 1) % _count;
+      index = _first + local;
+      return &rec;
+    }
+    return nullptr;
+  }
+
+  bool send(const command &cmd) {
+    if (!_block->_commands.push(cmd))
+      return false;
+    _segment->header()._bell.ring();
+    return true;
+  }
+
+  record *owned(const timer_handle &handle) const {
+    const auto index = handle_gen::index(handle);
+    if (index < _first || index >= _first + _count)
+      return nullptr;
+    record &rec = _segment->at(index);
+    return rec._generation == handle_gen::generation(handle) ? &rec : nullptr;
+  }
+
+ public:
+  shm_client(const shm_client &) = delete;
+  shm_client &operator=(const shm_client &) = delete;
+
+  ~shm_client() {
+    _block->_pid.store(0, std::memory_order_release);
+  }
+
+  /**
+   * \brief 以客户端 id 连接已有段；段不存在、id 越界、或该 id 已被另一个存活进程占用时返回 nullptr
+   */
+  static std::unique_ptr<shm_client> attach(const std::string &name, uint32_t id) {
+    auto seg = segment::open(name);
+    if (seg == nullptr || id >= seg->header()._clients || !claim(seg->client(id)->_pid))
+      return nullptr;
+    return std::unique_ptr<shm_client>(new shm_client(std::move(seg), id));
+  }
+
+  template <class payload_tt>
+  inline void register_type(uint32_t type, std::function<void(timer_handle, const payload_tt &)> &&callback) {
+    static_assert(std::is_trivially_copyable_v<payload_tt>, "payload must be POD");
+    static_assert(sizeof(payload_tt) <= payload_capacity, "payload too large");
+    if (_typed.size() <= type)
+      _typed.resize(type + 1);
+    _typed[type] = [callback = std::move(callback)](timer_handle handle, const void *payload) {
+      payload_tt value;
+      std::memcpy(&value, payload, sizeof(payload_tt));
+      callback(handle, value);
+    };
+  }
+
+  /**
+   * \brief 添加定时器：分区满、命令环满时返回 invalid_handle
+   * 回调类型在 drain 时按本进程 register_type 的注册查找，重启后需重新注册
+   */
+  template <class payload_tt, class Rep, class Period>
+  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, uint32_t type, const payload_tt &payload,
+    const time_duration &period = time_duration::zero(), const int64_t round = 0) {
+    static_assert(std::is_trivially_copyable_v<payload_tt>, "payload must be POD");
+    static_assert(sizeof(payload_tt) <= payload_capacity, "payload too large");
+    const uint64_t rounds = period.count() == 0 ? 1 : static_cast<uint64_t>(round);
+    if (rounds == 0)
+      return handle_gen::invalid_handle;
+
+    uint32_t index = 0;
+    record *rec = allocate(index);
+    if (rec == nullptr)
+      return handle_gen::invalid_handle;
+
+    rec->_generation += 1;
+    rec->_type = type;
+    rec->_size = sizeof(payload_tt);
+    std::memcpy(rec->_payload, &payload, sizeof(payload_tt));
+    rec->_next.store(tick() + std::chrono::duration_cast<time_duration>(when).count(), std::memory_order_relaxed);
+    rec->_period = period.count();
+    rec->_round.store(rounds, std::memory_order_relaxed);
+    rec->_state.store(static_cast<uint32_t>(record_state::pending), std::memory_order_release);
+
+    if (!send(command{command_op::arm, index, rec->_generation})) {
+      rec->_state.store(static_cast<uint32_t>(record_state::free), std::memory_order_release);
+      return handle_gen::invalid_handle;
+    }
+    return handle_gen::make(index, rec->_generation);
+  }
+
+  /**
+   * \brief 请求停止定时器，返回剩余时间；由 service 下一次 execute 生效，在那之前到期的通知仍会投递
+   * drain 时会跳过已被停止（记录已回收重用）的通知
+   */
+  inline time_duration stop(const timer_handle &handle) {
+    record *rec = owned(handle);
+    if (rec == nullptr)
+      return time_duration(0);
+    const auto state = static_cast<record_state>(rec->_state.load(std::memory_order_acquire));
+    if (state != record_state::pending && state != record_state::armed)
+      return time_duration(0);
+    if (!send(command{command_op::cancel, handle_gen::index(handle), handle_gen::generation(handle)}))
+      return time_duration(0);
+    const auto next_ = rec->_next.load(std::memory_order_relaxed);
+    const auto tick_ = tick();
+    return time_duration(next_ > tick_ ? next_ - tick_ : 0);
+  }
+
+  /**
+   * \brief 执行到期通知的回调，返回执行个数
+   * 最后一次到期的记录在回调之后回收，回调里仍可以读到 payload
+   */
+  inline std::size_t drain(std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+    return _block->_expired.drain(
+      [this](const expiry &item) {
+        const auto handle = item._handle;
+        record *rec = owned(handle);
+        if (rec == nullptr)
+          return;
+        const auto state = static_cast<record_state>(rec->_state.load(std::memory_order_acquire));
+        if (state == record_state::free || state == record_state::pending)
+          return;
+        if (rec->_type < _typed.size() && _typed[rec->_type])
+          _typed[rec->_type](handle, rec->_payload);
+        if (item._last) {
+          auto expected = static_cast<uint32_t>(record_state::fired);
+          rec->_state.compare_exchange_strong(
+            expected, static_cast<uint32_t>(record_state::free), std::memory_order_acq_rel);
+        }
+      },
+      limit);
+  }
+
+  // 等到期环里有通知或超时，返回是否有通知
+  inline bool wait(time_duration timeout) {
+    auto &expired = _block->_expired;
+    _block->_bell.wait([&expired]() { return !expired.empty(); }, timeout);
+    return !expired.empty();
+  }
+
+  inline uint32_t id() const {
+    return _id;
+  }
+};
+
+/**
+ * \brief 服务端：持有段的进程，用本地 timer_wheel 驱动所有客户端的定时器
+ * 同一个段同一时刻只能有一个存活的 service；进程重启后 create 同名段会接管并按记录表重建时间轮
+ */
+template <uint64_t precision_tt = 10>
+class shm_service {
+ private:
+  struct pending_delivery {
+    uint32_t _index = 0;
+    uint32_t _generation = 0;
+  };
+
+  std::unique_ptr<segment> _segment;
+  timer_wheel<precision_tt> _wheel;
+  std::vector<timer_handle> _local;        // 记录下标 -> 本地时间轮句柄
+  std::vector<pending_delivery> _backlog;  // 到期环满时没投出去的通知，下次 execute 重试
+  std::vector<pending_delivery> _retry;    // _backlog 的交换缓冲
+  std::vector<uint8_t> _touched;           // 本轮写过到期环的客户端
+  std::size_t _armed = 0;                  // 本地时间轮里的定时器数
+
+  explicit shm_service(std::unique_ptr<segment> &&seg)
+      : _segment(std::move(seg)), _local(_segment->capacity(), handle_gen::invalid_handle),
+        _touched(_segment->header()._clients, 0) {
+    recover();
+  }
+
+  // 重启接管：pending / armed 的记录重新放进时间轮，已过期的下一次 execute 立即触发
+  // fired 的记录不知道通知是否已写进到期环，再投递一次；客户端 drain 到重复的会按状态跳过
+  void recover() {
+    for (uint32_t index = 0; index < _segment->capacity(); ++index) {
+      record &rec = _segment->at(index);
+      const auto state = static_cast<record_state>(rec._state.load(std::memory_order_acquire));
+      if (state == record_state::pending || state == record_state::armed)
+        arm(index, rec._generation);
+      else if (state == record_state::fired)
+        deliver(index, rec._generation);
+    }
+  }
+
+  // 记录是否是 generation 这一代且 pending / armed
+  // 先看状态再读代数：客户端只改写 free 的记录，而 pending / armed 只有 service 能改回 free
+  bool live(const record &rec, uint32_t generation) const {
+    const auto state = static_cast<record_state>(rec._state.load(std::memory_order_acquire));
+    return (state == record_state::pending || state == record_state::armed) && rec._generation == generation;
+  }
+
+  void arm(uint32_t index, uint32_t generation) {
+    record &rec = _segment->at(index);
+    if (_local[index] != handle_gen::invalid_handle || !live(rec, generation))
+      return;
+    const auto next_ = rec._next.load(std::memory_order_relaxed);
+    const auto now_ = _wheel.now();
+    _local[index] = _wheel.add(time_duration(next_ > now_ ? next_ - now_ : 0),
+      [this, index, generation](timer_handle) { fire(index, generation); });
+    if (_local[index] == handle_gen::invalid_handle)
+      return;
+    rec._state.store(static_cast<uint32_t>(record_state::armed), std::memory_order_release);
+    _armed += 1;
+  }
+
+  void cancel(uint32_t index, uint32_t generation) {
+    record &rec = _segment->at(index);
+    if (!live(rec, generation))
+      return;
+    if (_local[index] != handle_gen::invalid_handle) {
+      _wheel.stop(_local[index]);
+      _local[index] = handle_gen::invalid_handle;
+      _armed -= 1;
+    }
+    rec._state.store(static_cast<uint32_t>(record_state::free), std::memory_order_release);
+  }
+
+  // 本地时间轮到期：写入客户端到期环，周期定时器成功后再推进记录（至少一次）
+  void fire(uint32_t index, uint32_t generation) {
+    _local[index] = handle_gen::invalid_handle;
+    _armed -= 1;
+    deliver(index, generation);
+  }
+
+  // 最后一次到期先置 fired 再写环：客户端 drain 到时记录一定已是 fired，置回 free 之后不会被这里覆盖
+  // 环满时保持 fired 进 backlog，重试（或重启后 recover）时照常投递
+  void deliver(uint32_t index, uint32_t generation) {
+    record &rec = _segment->at(index);
+    const auto state = static_cast<record_state>(rec._state.load(std::memory_order_acquire));
+    if ((state != record_state::armed && state != record_state::fired) || rec._generation != generation)
+      return;
+    const uint32_t client = index / _segment->header()._per_client;
+    const auto round = rec._round.load(std::memory_order_relaxed) - 1;
+    const bool last = round == 0 || rec._period == 0;
+    if (last && state == record_state::armed)
+      rec._state.store(static_cast<uint32_t>(record_state::fired), std::memory_order_release);
+    if (!_segment->client(client)->_expired.push(expiry{handle_gen::make(index, generation), last})) {
+      _backlog.push_back(pending_delivery{index, generation});
+      return;
+    }
+    _touched[client] = 1;
+
+    if (last)
+      return;
+    rec._round.store(round, std::memory_order_relaxed);
+    rec._next.store(_wheel.now() + rec._period, std::memory_order_relaxed);
+    _local[index] = _wheel.add(time_duration(rec._period), [this, index, generation](timer_handle) {
+      fire(index, generation);
+    });
+    if (_local[index] != handle_gen::invalid_handle)
+      _armed += 1;
+  }
+
+ public:
+  shm_service(const shm_service &) = delete;
+  shm_service &operator=(const shm_service &) = delete;
+
+  ~shm_service() {
+    _segment->header()._owner.store(0, std::memory_order_release);
+  }
+
+  /**
+   * \brief 创建段，或接管同名的已有段（几何参数需一致）；已有存活的 service 时返回 nullptr
+   * clients 个客户端，每个最多 per_client 个同时存活的定时器
+   */
+  static std::unique_ptr<shm_service> create(const std::string &name, uint32_t clients, uint32_t per_client) {
+    if (clients == 0 || per_client == 0)
+      return nullptr;
+    auto seg = segment::open(name, clients, per_client);
+    if (seg == nullptr || !claim(seg->header()._owner))
+      return nullptr;
+    return std::unique_ptr<shm_service>(new shm_service(std::move(seg)));
+  }
+
+  /**
+   * \brief 处理所有客户端的命令，推进时间轮，把到期通知写进各客户端的到期环并唤醒等待者
+   * 返回本轮处理的命令数
+   */
+  inline std::size_t execute() {
+    std::size_t commands = 0;
+    for (uint32_t client = 0; client < _segment->header()._clients; ++client) {
+      commands += _segment->client(client)->_commands.drain(
+        [this](const command &cmd) {
+          if (cmd._index >= _segment->capacity())
+            return;
+          if (cmd._op == command_op::arm)
+            arm(cmd._index, cmd._generation);
+          else if (cmd._op == command_op::cancel)
+            cancel(cmd._index, cmd._generation);
+        },
+        std::numeric_limits<std::size_t>::max());
+    }
+
+    if (!_backlog.empty()) {
+      _retry.swap(_backlog);
+      for (const auto &item : _retry)
+        deliver(item._index, item._generation);
+      _retry.clear();
+    }
+
+    _wheel.execute();
+
+    for (uint32_t client = 0; client < _touched.size(); ++client) {
+      if (_touched[client] == 0)
+        continue;
+      _touched[client] = 0;
+      _segment->client(client)->_bell.ring();
+    }
+    return commands;
+  }
+
+  // 等客户端的新命令或超时（驱动循环里代替 sleep(precision)）
+  inline void wait(time_duration timeout) {
+    auto *seg = _segment.get();
+    seg->header()._bell.wait(
+      [seg]() {
+        for (uint32_t client = 0; client < seg->header()._clients; ++client) {
+          if (!seg->client(client)->_commands.empty())
+            return true;
+        }
+        return false;
+      },
+      timeout);
+  }
+
+  // 时间轮里的定时器数
+  inline std::size_t armed() const {
+    return _armed;
+  }
+
+  inline std::size_t backlog() const {
+    return _backlog.size();
+  }
+};
+
+}  // namespace shm
+}  // namespace timer
+#endif
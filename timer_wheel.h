@@ -1,10 +1,24 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <queue>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include "crontab.h"
 
@@ -24,6 +38,9 @@ class empty_mutex {
  public:
   void lock() {}
   void unlock() {}
+  bool try_lock() {
+    return true;
+  }
 };
 
 template <typename duration_tt = std::chrono::milliseconds>
@@ -74,18 +91,22 @@ struct clock {
   // static constexpr bucket_t _0_bits = 6;
 
   static constexpr bucket_t _5_bits = 4;  // 1 -> 16
-  static constexpr bucket_t _4_bits = 2;  // 16 -> 64
-  static constexpr bucket_t _3_bits = 2;
-  static constexpr bucket_t _2_bits = 2;
-  static constexpr bucket_t _1_bits = 10;
-  static constexpr bucket_t _0_bits = 10;
-
-  static constexpr bucket_t _5_edge = 1ull << _5_bits;  // 1ms -> 1024ms(1s)
-  static constexpr bucket_t _4_edge = 1ull << _4_bits;  // 1024ms -> 262144ms(4min)
-  static constexpr bucket_t _3_edge = 1ull << _3_bits;  // 262144ms -> 16777216ms(4hour)
-  static constexpr bucket_t _2_edge = 1ull << _2_bits;  // 16777216ms -> 1073741824ms(12day)
-  static constexpr bucket_t _1_edge = 1ull << _1_bits;  // 1073741824ms -> 68719476736ms(795day)
-  static constexpr bucket_t _0_edge = 1ull << _0_bits;  // 68719476736ms -> 4398046511104(50903day)
+  static constexpr bucket_t _4_bits = 4;  // 16 -> 256
+  static constexpr bucket_t _3_bits = 4;
+  static constexpr bucket_t _2_bits = 6;
+  static constexpr bucket_t _1_bits = 6;
+  static constexpr bucket_t _0_bits = 6;
+
+  // 以 tick 计（precision 1ms 时即 ms）
+  static constexpr bucket_t _5_edge = 1ull << _5_bits;  // 1 -> 16
+  static constexpr bucket_t _4_edge = 1ull << _4_bits;  // 16 -> 256
+  static constexpr bucket_t _3_edge = 1ull << _3_bits;  // 256 -> 4096
+  static constexpr bucket_t _2_edge = 1ull << _2_bits;  // 4096 -> 262144(4.4min)
+  static constexpr bucket_t _1_edge = 1ull << _1_bits;  // 262144 -> 16777216(4.7hour)
+  static constexpr bucket_t _0_edge = 1ull << _0_bits;  // 16777216 -> 1073741824(12.4day, precision 10ms 时 124day)
+
+  // 时间轮一圈覆盖的 tick 位数，不在当前这一圈的定时器放在 overflow 里（见 timer_wheel::horizon）
+  static constexpr bucket_t _span_bits = _0_bits + _1_bits + _2_bits + _3_bits + _4_bits + _5_bits;
 
   // https://stackoverflow.com/questions/76605488/inconsistent-results-when-type-punning-uint64-t-with-union-and-bit-field
   constexpr bucket_t _5() const {
@@ -111,107 +132,356 @@ struct clock {
 static constexpr std::size_t bucket_count =
   clock::_5_edge + clock::_4_edge + clock::_3_edge + clock::_2_edge + clock::_1_edge + clock::_0_edge;
 
+// 以下按 _5 -> _0（由细到粗）排列
+// 各层一格对应的 tick 数（log2）：1, 16, 256, 4096, 1 << 18, 1 << 24
+static constexpr std::array<uint8_t, 6> level_shifts = {0, clock::_5_bits, clock::_5_bits + clock::_4_bits,
+  clock::_5_bits + clock::_4_bits + clock::_3_bits, clock::_5_bits + clock::_4_bits + clock::_3_bits + clock::_2_bits,
+  clock::_5_bits + clock::_4_bits + clock::_3_bits + clock::_2_bits + clock::_1_bits};
+// 各层位宽
+static constexpr std::array<uint8_t, 6> level_bits = {
+  clock::_5_bits, clock::_4_bits, clock::_3_bits, clock::_2_bits, clock::_1_bits, clock::_0_bits};
+// 各层第一个桶的全局下标：最细层在 timer_wheel::_fine，其余各层在 _coarse 里要减去 clock::_5_edge
+static constexpr std::array<std::size_t, 6> level_offsets = {0, clock::_5_edge, clock::_5_edge + clock::_4_edge,
+  clock::_5_edge + clock::_4_edge + clock::_3_edge, clock::_5_edge + clock::_4_edge + clock::_3_edge + clock::_2_edge,
+  clock::_5_edge + clock::_4_edge + clock::_3_edge + clock::_2_edge + clock::_1_edge};
+
+/**
+ * \brief 句柄编码
+ * 低 32 位：timer_wheel 槽位下标；高 32 位：槽位代数（generation）
+ * 槽位回收时代数 +1，旧句柄只需一次下标访问 + 比较即可判定失效
+ */
 struct handle_gen {
+  static constexpr timer_handle invalid_next = 0xFFFFFFFFull;      // 下标掩码（该下标不分配）
+  static constexpr timer_handle unlinked = 0xFFFFFFFEull;          // 槽位不在任何桶上（该下标不分配）
+  static constexpr timer_handle overflowed = 0xFFFFFFFDull;        // 槽位在 overflow 堆里（该下标不分配）
+  static constexpr timer_handle invalid_handle = 0x7FFFFFFFFFull;  // 无效句柄
+
+  static constexpr timer_handle make(uint32_t index, uint32_t generation) noexcept {
+    return (static_cast<timer_handle>(generation) << 32) | index;
+  }
+  static constexpr uint32_t index(timer_handle handle) noexcept {
+    return static_cast<uint32_t>(handle & invalid_next);
+  }
+  static constexpr uint32_t generation(timer_handle handle) noexcept {
+    return static_cast<uint32_t>(handle >> 32);
+  }
+};
+
+class spin_mutex {
  private:
-  std::mutex _mutex;
-  uint16_t _crc = 0;
-  std::queue<timer_handle> _free_ids;
+  std::atomic_flag _flag = ATOMIC_FLAG_INIT;
 
-  static timer_handle next() {
-    static std::atomic<timer_handle> next_ = 0;
-    if (++next_ == invalid_next) {
-      next_ = 1;  // warning....
+ public:
+  void lock() {
+    while (_flag.test_and_set(std::memory_order_acquire)) {
+      std::this_thread::yield();
     }
-    return next_;
   }
+  void unlock() {
+    _flag.clear(std::memory_order_release);
+  }
+  bool try_lock() {
+    return !_flag.test_and_set(std::memory_order_acquire);
+  }
+};
+
+/**
+ * \brief 零分配检查（仅调试版）
+ * timer_wheel::reserve() 之后，add/stop/execute 期间置位 active()，用户回调期间暂停
+ * 在自定义的 operator new 里调用 alloc_guard::check() 即可对热路径上的堆分配断言
+ */
+class alloc_guard {
+ private:
+#if !defined(NDEBUG)
+  bool _saved;
+
+  static bool &flag() noexcept {
+    static thread_local bool value = false;
+    return value;
+  }
+#endif
 
  public:
-  handle_gen() = default;
-  ~handle_gen() = default;
+#if !defined(NDEBUG)
+  explicit alloc_guard(bool active) noexcept : _saved(flag()) {
+    flag() = active;
+  }
+  ~alloc_guard() {
+    flag() = _saved;
+  }
 
-  static handle_gen &instance() {
-    static handle_gen inst;
-    return inst;
+  static bool active() noexcept {
+    return flag();
   }
+#else
+  explicit alloc_guard(bool) noexcept {}
 
-  static constexpr timer_handle invalid_next = 0xFFFFFFFFull;
-  static constexpr timer_handle invalid_handle = 0x7FFFFFFFFFull;
+  static bool active() noexcept {
+    return false;
+  }
+#endif
 
-  timer_handle get() noexcept {
-    auto make = [](timer_handle handle_, uint16_t &crc) -> timer_handle {
-      return (handle_ & invalid_next) | ((++crc & 0x7Full) << 32);
-    };
+  alloc_guard(const alloc_guard &) = delete;
+  alloc_guard &operator=(const alloc_guard &) = delete;
+
+  static void check() noexcept {
+    assert(!active() && "timer_wheel: heap allocation on reserved hot path");
+  }
+};
+
+/**
+ * \brief 事件对象池
+ * 控制块 + 事件按定长块从 chunk 中连续分配，省掉每个定时器的 malloc 头部与碎片
+ * 空闲块走侵入式链表；owner（timer_wheel）析构后 detach，最后一个块归还时释放自身
+ */
+class event_pool {
+ public:
+  // 块按指针对齐，对齐要求更高的类型由 pool_allocator 直接走 operator new
+  static constexpr std::size_t block_align = alignof(void *);
+
+ private:
+  struct size_class {
+    std::size_t _size = 0;                                  // 块大小
+    std::size_t _capacity = 0;                              // 总块数
+    void *_free = nullptr;                                  // 空闲链表
+    std::vector<std::unique_ptr<unsigned char[]>> _chunks;  // 已分配的 chunk
+  };
+
+  static constexpr std::size_t _chunk_blocks = 256;
+  static constexpr std::size_t _first_blocks = 16;  // 前几个 chunk 倍增到 _chunk_blocks，只有几个定时器的实例不占满一整块
+
+  spin_mutex _mutex;  // 事件可能在其他线程释放（stopped 回调里持有的 shared_ptr）
+  std::vector<size_class> _classes;
+  std::size_t _outstanding = 0;
+  std::size_t _last_size = 0;  // 最近一次申请的块大小（reserve 探测用）
+  bool _detached = false;
+
+  static constexpr std::size_t round_up(std::size_t size) {
+    return (std::max(size, sizeof(void *)) + block_align - 1) / block_align * block_align;
+  }
+
+  size_class &find_unsafe(std::size_t size) {
+    for (auto &item : _classes) {
+      if (item._size == size)
+        return item;
+    }
+    _classes.reserve(4);
+    _classes.emplace_back();
+    _classes.back()._size = size;
+    return _classes.back();
+  }
+
+  static void grow_unsafe(size_class &cls, std::size_t blocks) {
+    auto chunk = std::make_unique<unsigned char[]>(cls._size * blocks);
+    for (std::size_t i = blocks; i-- > 0;) {
+      void *block = chunk.get() + i * cls._size;
+      *static_cast<void **>(block) = cls._free;
+      cls._free = block;
+    }
+    cls._chunks.emplace_back(std::move(chunk));
+    cls._capacity += blocks;
+  }
+
+ public:
+  event_pool() = default;
+  event_pool(const event_pool &) = delete;
+  event_pool &operator=(const event_pool &) = delete;
+
+  void *allocate(std::size_t size) {
+    std::scoped_lock<spin_mutex> lock(_mutex);
+    auto &cls = find_unsafe(round_up(size));
+    if (cls._free == nullptr)
+      grow_unsafe(cls, std::clamp(cls._capacity, _first_blocks, _chunk_blocks));
+    void *block = cls._free;
+    _last_size = size;
+    cls._free = *static_cast<void **>(block);
+    _outstanding += 1;
+    return block;
+  }
+
+  void deallocate(void *block, std::size_t size) noexcept {
+    bool release = false;
+    {
+      std::scoped_lock<spin_mutex> lock(_mutex);
+      auto &cls = find_unsafe(round_up(size));
+      *static_cast<void **>(block) = cls._free;
+      cls._free = block;
+      _outstanding -= 1;
+      release = _detached && _outstanding == 0;
+    }
+    if (release)
+      delete this;
+  }
+
+  // 保证 size 大小的块总数 >= n
+  void reserve(std::size_t size, std::size_t n) {
+    std::scoped_lock<spin_mutex> lock(_mutex);
+    auto &cls = find_unsafe(round_up(size));
+    if (cls._capacity < n)
+      grow_unsafe(cls, n - cls._capacity);
+  }
+
+  std::size_t last_size() noexcept {
+    std::scoped_lock<spin_mutex> lock(_mutex);
+    return _last_size;
+  }
 
-    std::scoped_lock<std::mutex> lock(_mutex);  // todo: 待优化
-    if (_free_ids.empty()) {
-      static uint16_t default_crc = 1;
-      return make(next(), default_crc);
+  void detach() noexcept {
+    bool release = false;
+    {
+      std::scoped_lock<spin_mutex> lock(_mutex);
+      _detached = true;
+      release = _outstanding == 0;
     }
-    auto result = _free_ids.front();
-    _free_ids.pop();
-    return make(result, _crc);
+    if (release)
+      delete this;
+  }
+};
+
+template <class value_tt>
+struct pool_allocator {
+  using value_type = value_tt;
+
+  event_pool *_pool = nullptr;
+
+  explicit pool_allocator(event_pool *pool) noexcept : _pool(pool) {}
+  template <class other_tt>
+  pool_allocator(const pool_allocator<other_tt> &other) noexcept : _pool(other._pool) {}
+
+  static constexpr bool pooled = alignof(value_tt) <= event_pool::block_align;
+
+  value_tt *allocate(std::size_t n) {
+    if (n != 1 || !pooled)
+      return static_cast<value_tt *>(::operator new(n * sizeof(value_tt)));
+    return static_cast<value_tt *>(_pool->allocate(sizeof(value_tt)));
+  }
+
+  void deallocate(value_tt *ptr, std::size_t n) noexcept {
+    if (n != 1 || !pooled)
+      return ::operator delete(ptr);
+    _pool->deallocate(ptr, sizeof(value_tt));
   }
 
-  void put(timer_handle handle_) noexcept {
-    std::scoped_lock<std::mutex> lock(_mutex);  // todo: 待优化
-    _free_ids.push(handle_ & invalid_next);
+  template <class other_tt>
+  bool operator==(const pool_allocator<other_tt> &other) const noexcept {
+    return _pool == other._pool;
+  }
+  template <class other_tt>
+  bool operator!=(const pool_allocator<other_tt> &other) const noexcept {
+    return _pool != other._pool;
   }
 };
 
+template <class alloc_tt>
+static event_pool *pool_of(const alloc_tt &) noexcept {
+  return nullptr;
+}
+
+template <class value_tt>
+static event_pool *pool_of(const pool_allocator<value_tt> &alloc) noexcept {
+  return alloc._pool;
+}
+
 struct event_interface;
 using timer_callback = std::function<void(timer_handle)>;
 using timer_stopped_callback = std::function<void(std::shared_ptr<event_interface>)>;
 
-struct event_interface {
-  timer_handle _handle = handle_gen::invalid_handle;   // 句柄
-  time64_t _next = 0;                                  // 下次执行时间
-  time64_t _period = 0;                                // 间隔时间
-  uint64_t _round = 1;                                 // 执行轮次（剩余）
-  timer_callback _callback = nullptr;                  // 回调
+// 冷数据：大部分定时器不需要，按需分配
+struct event_cold {
   timer_stopped_callback _stopped_callback = nullptr;  // 停止回调
+  std::string _remark{};                               // debug remark
+};
 
-  std::string _remark{};  // debug remark
+// 事件种类：重排按它分派，不走虚函数；事件都由 allocate_shared 按具体类型创建，析构由控制块负责
+enum class event_kind : uint8_t {
+  custom = 0,   // 一次性 / 周期，见 event_custom
+  crontab = 1,  // 见 event_crontab
+  typed = 2,    // add_typed，见 event_typed
+  batch = 3,    // add_typed 且类型由 register_batch 注册：到期只攒进批量缓冲，见 timer_wheel::collect
+};
 
-  explicit event_interface(
-    time64_t nxt, time64_t period, uint64_t round, timer_callback &&cb, timer_stopped_callback &&stopped_cb)
-      : _next(nxt),
-        _period(period),
-        _round(round),
-        _callback(std::forward<timer_callback>(cb)),
-        _stopped_callback(std::forward<timer_stopped_callback>(stopped_cb)) {
-    _handle = handle_gen::instance().get();
+struct event_interface {
+  timer_handle _handle = handle_gen::invalid_handle;  // 句柄（由容器分配）
+  time64_t _next = 0;                                 // 下次执行时间
+  time64_t _period = 0;                               // 间隔时间
+  uint64_t _round = 1;                                // 执行轮次（剩余）
+  uint64_t _owner = 0;                                // 所属分组，0 表示不分组
+  uint32_t _slack = 0;                                // 允许推迟的 tick 数；打散时为窗口 tick 数
+  uint32_t _shift = 0;                                // 本轮被 slack/resolution 推迟的 tick 数；打散时为相位
+  uint8_t _resolution = 0;                            // 到期 tick 对齐到 1 << _resolution
+  uint8_t _lane = 1;                                  // 优先级通道，见 timer_lane
+  uint8_t _spread = 0;                                // 打散方式，见 spread_mode，0 表示不打散
+  uint8_t _rate = 0;                                  // 0 为 fixed_delay；否则 fixed_rate，值为 1 + 追赶上限
+  event_kind _kind = event_kind::custom;              // 事件种类（取代虚表指针）
+  uint32_t _affinity = 0xFFFFFFFF;                    // 回调投递的目标线程，见 alert_affinity
+  timer_callback _callback = nullptr;                 // 回调
+  event_cold *_cold = nullptr;                        // 停止回调、remark（按需分配）
+  event_pool *_pool = nullptr;                        // _cold 的来源，nullptr 时走堆
+
+  explicit event_interface(time64_t nxt, time64_t period, uint64_t round, timer_callback &&cb,
+    timer_stopped_callback &&stopped_cb, event_pool *pool = nullptr)
+      : _next(nxt), _period(period), _round(round), _callback(std::forward<timer_callback>(cb)), _pool(pool) {
     if (_period == 0)
       _round = 1;
+    if (stopped_cb)
+      cold()._stopped_callback = std::forward<timer_stopped_callback>(stopped_cb);
   }
-  virtual ~event_interface() {
-    if (_handle == handle_gen::invalid_handle)
+  event_interface(const event_interface &) = delete;
+  event_interface &operator=(const event_interface &) = delete;
+
+  ~event_interface() {
+    if (_cold == nullptr)
       return;
-    handle_gen::instance().put(_handle);
+    _cold->~event_cold();
+    if (_pool)
+      _pool->deallocate(_cold, sizeof(event_cold));
+    else
+      ::operator delete(_cold);
+  }
+
+  // next trigger time，now 为容器时间源的当前毫秒；按 _kind 分派，precision_tt 与创建时一致
+  template <uint64_t precision_tt>
+  time64_t next(time64_t now);
+
+  event_cold &cold() {
+    if (_cold == nullptr) {
+      void *block = _pool ? _pool->allocate(sizeof(event_cold)) : ::operator new(sizeof(event_cold));
+      _cold = new (block) event_cold();
+    }
+    return *_cold;
+  }
+
+  const std::string &remark() const {
+    static const std::string empty{};
+    return _cold ? _cold->_remark : empty;
   }
 
-  virtual time64_t next() = 0;  // next trigger time
+  // 停止回调只触发一次
+  static void stopped(const std::shared_ptr<event_interface> &evt) {
+    if (evt == nullptr || evt->_cold == nullptr || !evt->_cold->_stopped_callback)
+      return;
+    auto callback = std::move(evt->_cold->_stopped_callback);
+    evt->_cold->_stopped_callback = nullptr;
+    callback(evt);
+  }
 };
 
 template <uint64_t precision_tt = 10>
 struct event_custom : public event_interface {
   static constexpr time64_t _precision = precision_tt;
 
-  explicit event_custom(
-    time64_t nxt, time64_t period, uint64_t round, timer_callback &&cb, timer_stopped_callback &&stopped_cb)
-      : event_interface(
-          nxt, period, round, std::forward<timer_callback>(cb), std::forward<timer_stopped_callback>(stopped_cb)) {}
+  explicit event_custom(time64_t nxt, time64_t period, uint64_t round, timer_callback &&cb,
+    timer_stopped_callback &&stopped_cb, event_pool *pool = nullptr)
+      : event_interface(nxt, period, round, std::forward<timer_callback>(cb),
+          std::forward<timer_stopped_callback>(stopped_cb), pool) {}
 
   ~event_custom() {}
 
-  virtual time64_t next() {
-    event_interface::_next = (tick() + _period) / _precision;
-    return _next;
-  }
-
-  static std::shared_ptr<event_interface> create(
-    time64_t nxt, time64_t period, uint64_t round, timer_callback &&cb, timer_stopped_callback &&stopped_cb) {
-    std::shared_ptr<event_custom> result = std::make_shared<event_custom>(
-      nxt, period, round, std::forward<timer_callback>(cb), std::forward<timer_stopped_callback>(stopped_cb));
+  template <class alloc_tt = std::allocator<event_custom>>
+  static std::shared_ptr<event_interface> create(time64_t nxt, time64_t period, uint64_t round, timer_callback &&cb,
+    timer_stopped_callback &&stopped_cb, const alloc_tt &alloc = alloc_tt()) {
+    std::shared_ptr<event_custom> result = std::allocate_shared<event_custom>(alloc, nxt, period, round,
+      std::forward<timer_callback>(cb), std::forward<timer_stopped_callback>(stopped_cb), pool_of(alloc));
     return result;
   }
 };
@@ -220,279 +490,2322 @@ template <uint64_t precision_tt = 10>
 struct event_crontab : public event_interface {
   static constexpr time64_t _precision = precision_tt;
 
-  cron::cronexpr _cronexpr;  // cronexpr
+  util::cron::cronexpr _cronexpr;  // cronexpr
 
-  explicit event_crontab(timer_callback &&cb, timer_stopped_callback &&stopped_cb)
-      : event_interface(tick() / _precision, -1, -1, std::forward<timer_callback>(cb),
-          std::forward<timer_stopped_callback>(stopped_cb)) {}
+  explicit event_crontab(
+    time64_t now, timer_callback &&cb, timer_stopped_callback &&stopped_cb, event_pool *pool = nullptr)
+      : event_interface(now / _precision, -1, -1, std::forward<timer_callback>(cb),
+          std::forward<timer_stopped_callback>(stopped_cb), pool) {
+    event_interface::_kind = event_kind::crontab;
+  }
 
   ~event_crontab() {}
 
-  virtual time64_t next() {
+  time64_t next(time64_t) {
     auto last = event_interface::_next * _precision / 1000;
-    event_interface::_next = cron::cron_next(_cronexpr, last) * 1000 / _precision;
+    event_interface::_next = util::cron::cron_next(_cronexpr, last) * 1000 / _precision;
     return event_interface::_next;
   }
 
-  static std::shared_ptr<event_interface> create(
-    const std::string &cron_str, timer_callback &&cb, timer_stopped_callback &&stopped_cb) {
+  template <class alloc_tt = std::allocator<event_crontab>>
+  static std::shared_ptr<event_interface> create(const std::string &cron_str, timer_callback &&cb,
+    timer_stopped_callback &&stopped_cb, const alloc_tt &alloc = alloc_tt(), time64_t now = tick()) {
     try {
-      std::shared_ptr<event_crontab> result = std::make_shared<event_crontab>(
-        std::forward<timer_callback>(cb), std::forward<timer_stopped_callback>(stopped_cb));
-      result->_cronexpr = cron::make_cron(cron_str);
-      result->next();
+      std::shared_ptr<event_crontab> result = std::allocate_shared<event_crontab>(alloc, now,
+        std::forward<timer_callback>(cb), std::forward<timer_stopped_callback>(stopped_cb), pool_of(alloc));
+      result->_cronexpr = util::cron::make_cron(cron_str);
+      result->next(now);
       return result;
-    } catch (cron::bad_cronexpr const &ex) {
+    } catch (util::cron::bad_cronexpr const &ex) {
       // todo: log
       return nullptr;
     }
   }
+};
 
-  static std::shared_ptr<event_interface> create(
-    std::string &&cron_str, timer_callback &&cb, timer_stopped_callback &&stopped_cb) {
-    try {
-      std::shared_ptr<event_crontab> result = std::make_shared<event_crontab>(
-        std::forward<timer_callback>(cb), std::forward<timer_stopped_callback>(stopped_cb));
-      result->_cronexpr = cron::make_cron(cron_str);
-      result->next();
-      return result;
-    } catch (cron::bad_cronexpr const &ex) {
-      // todo: log
+// 可快照的回调：按注册的类型 id 引用，参数是定时器携带的 POD payload
+static constexpr std::size_t payload_capacity = 32;
+using typed_callback = std::function<void(timer_handle, const void *)>;
+
+template <uint64_t precision_tt = 10>
+struct event_typed : public event_custom<precision_tt> {
+  uint32_t _type = 0;                                     // 注册的回调类型 id
+  uint32_t _size = 0;                                     // payload 实际字节数
+  std::array<unsigned char, payload_capacity> _payload{};  // POD payload
+
+  explicit event_typed(time64_t nxt, time64_t period, uint64_t round, event_pool *pool = nullptr)
+      : event_custom<precision_tt>(nxt, period, round, nullptr, nullptr, pool) {
+    event_interface::_kind = event_kind::typed;
+  }
+
+  ~event_typed() {}
+
+  // registry 由 timer_wheel 持有，生命周期长于事件
+  template <class alloc_tt = std::allocator<event_typed>>
+  static std::shared_ptr<event_interface> create(time64_t nxt, time64_t period, uint64_t round, uint32_t type,
+    const void *payload, std::size_t size, const std::vector<typed_callback> *registry,
+    const alloc_tt &alloc = alloc_tt()) {
+    if (size > payload_capacity)
       return nullptr;
-    }
+    std::shared_ptr<event_typed> result = std::allocate_shared<event_typed>(alloc, nxt, period, round, pool_of(alloc));
+    result->_type = type;
+    result->_size = static_cast<uint32_t>(size);
+    if (size)
+      std::memcpy(result->_payload.data(), payload, size);
+    // 只捕获两个指针，落在 std::function 的小对象缓冲里
+    result->_callback = [registry, self = result.get()](timer_handle handle) {
+      (*registry)[self->_type](handle, self->_payload.data());
+    };
+    return result;
   }
 };
 
+template <uint64_t precision_tt>
+inline time64_t event_interface::next(time64_t now) {
+  if (_kind == event_kind::crontab)
+    return static_cast<event_crontab<precision_tt> &>(*this).next(now);
+  _next = (now + _period) / precision_tt;
+  return _next;
+}
+
+static constexpr uint32_t affinity_none = 0xFFFFFFFF;  // 不指定投递线程
+
+/**
+ * \brief 回调投递策略（timer_wheel 的 alert 模板参数）
+ * execute 线程里到期的回调、轮次用完的 stopped 回调经由它投递；一轮 execute 结束调用 alert_flush
+ * 用户线程里 stop/stop_group 触发的 stopped 回调仍在调用线程直接执行
+ */
 class alert_interface {
  public:
   alert_interface() = default;
   virtual ~alert_interface() = default;
 
-  virtual void alert_callback(std::shared_ptr<event_interface>) = 0;
-  virtual void alert_stopped(std::shared_ptr<event_interface>) = 0;
+  virtual void alert_callback(const std::shared_ptr<event_interface> &) = 0;
+  virtual void alert_stopped(const std::shared_ptr<event_interface> &) = 0;
+  virtual void alert_flush() {}
 };
 
+// 默认：在 execute 线程直接调用
 class alert_default final : public alert_interface {
  public:
   alert_default() = default;
   ~alert_default() override = default;
 
-  void alert_callback(std::shared_ptr<event_interface> evt) override {
+  void alert_callback(const std::shared_ptr<event_interface> &evt) override {
     if (evt && evt->_callback) {
       evt->_callback(evt->_handle);
     }
   }
 
-  void alert_stopped(std::shared_ptr<event_interface> evt) override {
-    if (evt && evt->_stopped_callback) {
-      evt->_stopped_callback(evt);
-      evt->_stopped_callback = nullptr;
-    }
+  void alert_stopped(const std::shared_ptr<event_interface> &evt) override {
+    event_interface::stopped(evt);
   }
 };
 
-template <std::size_t thread_count>
-class alert_mt final : public alert_interface {
- private:
-  std::array<std::thread, thread_count> _threads;
-  std::queue<std::shared_ptr<event_interface>> _evt_queue;  // timer_wheel push, _threads pop
-  std::mutex _mux;
-};
+/**
+ * \brief 单生产者单消费者环形队列
+ * 生产者 push 只写本地尾指针，flush 时一次性发布，消费者按批次看到
+ */
+template <class value_tt, std::size_t capacity_tt>
+class spsc_ring {
+  static_assert((capacity_tt & (capacity_tt - 1)) == 0, "capacity must be a power of two");
 
-template <uint64_t precision_tt = 10, class mutex_tt = empty_mutex, class alert = alert_default>
-class timer_wheel {
  private:
-  mutex_tt _mutex;
-  static constexpr time64_t _precision = precision_tt;  // 精度
+  static constexpr std::size_t _mask = capacity_tt - 1;
 
-  std::vector<std::queue<timer_handle>> _wheels;  // 时间轮
-  std::unordered_map<timer_handle, std::shared_ptr<event_interface>> _events;
-
-  time64_t _tick = tick() / _precision;  // 扳手时钟
+  std::unique_ptr<value_tt[]> _items = std::make_unique<value_tt[]>(capacity_tt);
+  alignas(64) std::atomic<std::size_t> _head = 0;  // 消费者已取到的位置
+  alignas(64) std::atomic<std::size_t> _tail = 0;  // 生产者已发布的位置
+  alignas(64) std::size_t _pending = 0;            // 生产者本地尾
+  std::size_t _head_cache = 0;                     // 生产者缓存的 _head
 
  public:
-  timer_wheel() {
-    std::scoped_lock<mutex_tt> lock(_mutex);
-    _wheels.resize(bucket_count);
+  // 满时返回 false
+  bool push(value_tt &&value) {
+    if (_pending - _head_cache == capacity_tt) {
+      _head_cache = _head.load(std::memory_order_acquire);
+      if (_pending - _head_cache == capacity_tt)
+        return false;
+    }
+    _items[_pending & _mask] = std::move(value);
+    _pending += 1;
+    return true;
   }
 
-  template <class Rep, class Period>
-  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
-    timer_stopped_callback &&stopped_callback = nullptr, const time_duration &period = time_duration::zero(),
-    const int64_t round = 0) {
-    std::shared_ptr<event_interface> event_ = event_custom<_precision>::create(
-      std::chrono::duration_cast<time_duration>((time_clock::now() + when).time_since_epoch()).count() / _precision,
-      period.count(), round, std::forward<timer_callback>(callback),
-      std::forward<timer_stopped_callback>(stopped_callback));
+  void flush() {
+    _tail.store(_pending, std::memory_order_release);
+  }
 
-    if (event_ == nullptr) {
-      return handle_gen::invalid_handle;
+  // 消费者：最多取 limit 个，返回处理个数
+  template <class fn_tt>
+  std::size_t drain(fn_tt &&fn, std::size_t limit) {
+    auto head = _head.load(std::memory_order_relaxed);
+    const auto tail = _tail.load(std::memory_order_acquire);
+    std::size_t count = 0;
+    while (head != tail && count < limit) {
+      value_tt value = std::move(_items[head & _mask]);
+      head += 1;
+      count += 1;
+      fn(std::move(value));
     }
+    _head.store(head, std::memory_order_release);
+    return count;
+  }
+};
 
-    {
-      std::scoped_lock<mutex_tt> lock(_mutex);
-      _events.emplace(event_->_handle, event_);
-      submit_unsafe(event_);
+/**
+ * \brief 按 affinity 投递：回调不在 execute 线程执行，而是放进目标工作线程的 SPSC 环，由该线程 drain 时执行
+ * timer_options::_affinity 为 affinity_none 的定时器仍在 execute 线程直接执行
+ * 环满时 execute 线程先 flush 再让出 CPU 等待消费者，容量应覆盖一次 execute 的峰值
+ * 生产者只能是 execute 线程，每个环只能由对应的一个工作线程 drain
+ */
+template <std::size_t worker_count, std::size_t capacity_tt = 4096>
+class alert_affinity final : public alert_interface {
+ private:
+  struct delivery {
+    std::shared_ptr<event_interface> _event = nullptr;
+    bool _stopped = false;  // true: stopped 回调；false: 到期回调
+  };
+
+  std::array<spsc_ring<delivery, capacity_tt>, worker_count> _rings;
+
+  void deliver(const std::shared_ptr<event_interface> &evt, bool stopped) {
+    auto &ring = _rings[evt->_affinity % worker_count];
+    delivery item{evt, stopped};
+    while (!ring.push(std::move(item))) {
+      ring.flush();
+      std::this_thread::yield();
     }
-    return event_->_handle;
   }
 
-  inline timer_handle add(
-    const std::string &cron_str, timer_callback &&callback, timer_stopped_callback &&stopped_callback = nullptr) {
-    std::shared_ptr<event_interface> event_ = event_crontab<_precision>::create(
-      cron_str, std::forward<timer_callback>(callback), std::forward<timer_stopped_callback>(stopped_callback));
+ public:
+  alert_affinity() = default;
+  ~alert_affinity() override = default;
 
-    {
-      std::scoped_lock<mutex_tt> lock(_mutex);
-      _events.emplace(event_->_handle, event_);
-      submit_unsafe(event_);
+  void alert_callback(const std::shared_ptr<event_interface> &evt) override {
+    if (evt->_affinity == affinity_none) {
+      if (evt->_callback)
+        evt->_callback(evt->_handle);
+      return;
     }
-    return event_->_handle;
+    deliver(evt, false);
   }
 
-  inline timer_handle add(
-    std::string &&cron_str, timer_callback &&callback, timer_stopped_callback &&stopped_callback = nullptr) {
-    std::shared_ptr<event_interface> event_ = event_crontab<_precision>::create(std::forward<std::string>(cron_str),
-      std::forward<timer_callback>(callback), std::forward<timer_stopped_callback>(stopped_callback));
-
-    {
-      std::scoped_lock<mutex_tt> lock(_mutex);
-      _events.emplace(event_->_handle, event_);
-      submit_unsafe(event_);
+  void alert_stopped(const std::shared_ptr<event_interface> &evt) override {
+    if (evt->_affinity == affinity_none || evt->_cold == nullptr) {
+      event_interface::stopped(evt);
+      return;
     }
-    return event_->_handle;
+    deliver(evt, true);
   }
 
-  inline time_duration stop(const timer_handle &handle) {
-    std::shared_ptr<event_interface> evt = nullptr;
-    {
-      std::scoped_lock<mutex_tt> lock(_mutex);
-      const auto iter = _events.find(handle);
-      if (iter == _events.end() || iter->second == nullptr)
-        return time_duration(0);
-      evt = iter->second;
-      _events.erase(iter);
-    }
+  void alert_flush() override {
+    for (auto &ring : _rings)
+      ring.flush();
+  }
 
-    if (evt->_stopped_callback) {
-      evt->_stopped_callback(evt);
-      evt->_stopped_callback = nullptr;
-    }
+  // 工作线程 worker 调用：执行投递给它的回调，返回执行个数
+  std::size_t drain(std::size_t worker, std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+    return _rings[worker].drain(
+      [](delivery &&item) {
+        if (item._stopped) {
+          event_interface::stopped(item._event);
+        } else if (item._event->_callback) {
+          item._event->_callback(item._event->_handle);
+        }
+      },
+      limit);
+  }
+};
 
-    const auto tick_ = tick();
-    const auto next_ = evt->_next * _precision;
-    if (next_ >= tick_)
-      return time_duration(next_ - tick_);
-    return time_duration(0);
+template <std::size_t thread_count>
+class alert_mt final : public alert_interface {
+ private:
+  std::array<std::thread, thread_count> _threads;
+  std::queue<std::shared_ptr<event_interface>> _evt_queue;  // timer_wheel push, _threads pop
+  std::mutex _mux;
+};
+
+static constexpr std::size_t level_count = 6;  // clock::_0 .. clock::_5
+
+struct metrics_snapshot {
+  uint64_t adds = 0;                                 // add 次数
+  uint64_t stops = 0;                                // stop 成功次数
+  uint64_t fires = 0;                                // 回调触发次数（含批量投递的定时器）
+  uint64_t tombstones = 0;                           // 扫到时才回收的已停止句柄（桶里和 overflow 堆里）
+  uint64_t live = 0;                                 // 当前存活定时器
+  std::array<uint64_t, level_count> queued{};        // 每层当前排队的句柄数（含已停止）
+  std::array<uint64_t, level_count> cascades{};      // 每层未触发、重新 submit 的次数
+  uint64_t max_bucket_depth = 0;                     // step_list 见过的最大桶深度
+  uint64_t executes = 0;                             // execute 次数
+  uint64_t execute_ns = 0;                           // execute 总耗时
+  uint64_t execute_max_ns = 0;                       // execute 单次最大耗时
+  uint64_t callback_ns = 0;                          // 其中回调耗时（含批量回调）
+  uint64_t wakeups = 0;                              // 至少触发了一个回调的 tick 数
+  uint64_t coalesced = 0;                            // 被 slack 推迟对齐的次数
+  uint64_t ticks_saved = 0;                          // 合并省下的 tick（同一 tick 内不同原始到期 tick 数 - 1）
+};
+
+// 默认：不统计，所有接口编译期消除
+class metrics_empty {
+ public:
+  static constexpr bool enabled = false;
+
+  void on_add() {}
+  void on_stop() {}
+  void on_fire(uint64_t) {}
+  void on_batch(uint64_t) {}
+  void on_finish() {}
+  void on_tombstone(uint64_t = 1) {}
+  void on_submit(std::size_t) {}
+  void on_pop(std::size_t) {}
+  void on_cascade(std::size_t) {}
+  void on_bucket(uint64_t) {}
+  void on_execute(uint64_t) {}
+  void on_wakeup() {}
+  void on_coalesce() {}
+  void on_tick_saved() {}
+
+  metrics_snapshot snapshot() const {
+    return {};
   }
+};
 
-  inline void execute() {
-    const auto tick_now = tick() / _precision;
+// relaxed 原子计数，可跨线程 snapshot
+class metrics_atomic {
+ private:
+  template <typename value_tt>
+  static void store_max(std::atomic<value_tt> &target, value_tt value) {
+    auto current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
 
-    while (_tick <= tick_now) {
-      clock clk = {_tick};
-
-      if (clk._5()) {
-        step_list(_wheels[clk._5()]);
-      } else if (clk._4()) {
-        step_list(_wheels[clk._4() + clock::_5_edge]);
-      } else if (clk._3()) {
-        step_list(_wheels[clk._3() + clock::_4_edge + clock::_5_edge]);
-      } else if (clk._2()) {
-        step_list(_wheels[clk._2() + clock::_3_edge + clock::_4_edge + clock::_5_edge]);
-      } else if (clk._1()) {
-        step_list(_wheels[clk._1() + clock::_2_edge + clock::_3_edge + clock::_4_edge + clock::_5_edge]);
-      } else if (clk._0()) {
-        step_list(
-          _wheels[clk._0() + clock::_1_edge + clock::_2_edge + clock::_3_edge + clock::_4_edge + clock::_5_edge]);
-      }
+  std::atomic<uint64_t> _adds = 0;
+  std::atomic<uint64_t> _stops = 0;
+  std::atomic<uint64_t> _fires = 0;
+  std::atomic<uint64_t> _tombstones = 0;
+  std::atomic<int64_t> _live = 0;
+  std::array<std::atomic<int64_t>, level_count> _queued{};
+  std::array<std::atomic<uint64_t>, level_count> _cascades{};
+  std::atomic<uint64_t> _max_bucket_depth = 0;
+  std::atomic<uint64_t> _executes = 0;
+  std::atomic<uint64_t> _execute_ns = 0;
+  std::atomic<uint64_t> _execute_max_ns = 0;
+  std::atomic<uint64_t> _callback_ns = 0;
+  std::atomic<uint64_t> _wakeups = 0;
+  std::atomic<uint64_t> _coalesced = 0;
+  std::atomic<uint64_t> _ticks_saved = 0;
 
-      if (_tick == tick_now)
-        break;
+ public:
+  static constexpr bool enabled = true;
+
+  void on_add() {
+    _adds.fetch_add(1, std::memory_order_relaxed);
+    _live.fetch_add(1, std::memory_order_relaxed);
+  }
+  void on_stop() {
+    _stops.fetch_add(1, std::memory_order_relaxed);
+    _live.fetch_sub(1, std::memory_order_relaxed);
+  }
+  void on_fire(uint64_t callback_ns) {
+    _fires.fetch_add(1, std::memory_order_relaxed);
+    _callback_ns.fetch_add(callback_ns, std::memory_order_relaxed);
+  }
+  void on_batch(uint64_t callback_ns) {  // 批量回调耗时，触发数已由 on_fire 逐个计入
+    _callback_ns.fetch_add(callback_ns, std::memory_order_relaxed);
+  }
+  void on_finish() {  // 轮次用完，自然结束
+    _live.fetch_sub(1, std::memory_order_relaxed);
+  }
+  void on_tombstone(uint64_t count = 1) {
+    _tombstones.fetch_add(count, std::memory_order_relaxed);
+  }
+  void on_submit(std::size_t level) {
+    _queued[level].fetch_add(1, std::memory_order_relaxed);
+  }
+  void on_pop(std::size_t level) {
+    _queued[level].fetch_sub(1, std::memory_order_relaxed);
+  }
+  void on_cascade(std::size_t level) {
+    _cascades[level].fetch_add(1, std::memory_order_relaxed);
+  }
+  void on_bucket(uint64_t depth) {
+    store_max(_max_bucket_depth, depth);
+  }
+  void on_execute(uint64_t ns) {
+    _executes.fetch_add(1, std::memory_order_relaxed);
+    _execute_ns.fetch_add(ns, std::memory_order_relaxed);
+    store_max(_execute_max_ns, ns);
+  }
+  void on_wakeup() {
+    _wakeups.fetch_add(1, std::memory_order_relaxed);
+  }
+  void on_coalesce() {
+    _coalesced.fetch_add(1, std::memory_order_relaxed);
+  }
+  void on_tick_saved() {
+    _ticks_saved.fetch_add(1, std::memory_order_relaxed);
+  }
 
-      _tick += 1;
+  metrics_snapshot snapshot() const {
+    metrics_snapshot result;
+    result.adds = _adds.load(std::memory_order_relaxed);
+    result.stops = _stops.load(std::memory_order_relaxed);
+    result.fires = _fires.load(std::memory_order_relaxed);
+    result.tombstones = _tombstones.load(std::memory_order_relaxed);
+    result.live = static_cast<uint64_t>(std::max<int64_t>(_live.load(std::memory_order_relaxed), 0));
+    for (std::size_t i = 0; i < level_count; ++i) {
+      result.queued[i] = static_cast<uint64_t>(std::max<int64_t>(_queued[i].load(std::memory_order_relaxed), 0));
+      result.cascades[i] = _cascades[i].load(std::memory_order_relaxed);
     }
+    result.max_bucket_depth = _max_bucket_depth.load(std::memory_order_relaxed);
+    result.executes = _executes.load(std::memory_order_relaxed);
+    result.execute_ns = _execute_ns.load(std::memory_order_relaxed);
+    result.execute_max_ns = _execute_max_ns.load(std::memory_order_relaxed);
+    result.callback_ns = _callback_ns.load(std::memory_order_relaxed);
+    result.wakeups = _wakeups.load(std::memory_order_relaxed);
+    result.coalesced = _coalesced.load(std::memory_order_relaxed);
+    result.ticks_saved = _ticks_saved.load(std::memory_order_relaxed);
+    return result;
   }
+};
+
+// 回调耗时/触发延迟采样，超过阈值的回调交给 hook 并按 _remark 聚合
+using slow_callback_hook = std::function<void(
+  timer_handle handle, const std::string &remark, std::chrono::nanoseconds elapsed, time_duration lateness)>;
+
+struct slow_callback_stat {
+  std::string _remark{};                   // 聚合 tag
+  uint64_t _count = 0;                     // 超阈值次数
+  std::chrono::nanoseconds _total{0};      // 累计耗时
+  std::chrono::nanoseconds _max{0};        // 单次最大耗时
+  time_duration _max_lateness{0};          // 最大触发延迟
+};
 
+class callback_profiler {
  private:
-  inline void submit_unsafe(std::shared_ptr<event_interface> evt) {
-    if (nullptr == evt)
-      return;
+  std::chrono::nanoseconds _threshold;
+  slow_callback_hook _hook;
+  std::unordered_map<std::string, slow_callback_stat> _slow;
+  time_duration _max_lateness{0};
 
-    if (evt->_next < _tick) {
-      evt->_next = _tick;
-    }
+ public:
+  callback_profiler(std::chrono::nanoseconds threshold, slow_callback_hook &&hook)
+      : _threshold(threshold), _hook(std::forward<slow_callback_hook>(hook)) {}
+
+  // 只更新聚合，返回是否超阈值；hook 由调用方解锁后再调用
+  bool record(const std::string &remark, std::chrono::nanoseconds elapsed, time_duration lateness) {
+    _max_lateness = std::max(_max_lateness, lateness);
+    if (elapsed < _threshold)
+      return false;
+
+    auto &stat = _slow[remark];
+    if (stat._count == 0)
+      stat._remark = remark;
+    stat._count += 1;
+    stat._total += elapsed;
+    stat._max = std::max(stat._max, elapsed);
+    stat._max_lateness = std::max(stat._max_lateness, lateness);
+    return true;
+  }
 
-    clock clk1 = {evt->_next};
-    clock clk2 = {_tick};
+  const slow_callback_hook &hook() const {
+    return _hook;
+  }
 
-    if (clk1._0() != clk2._0()) {
-      _wheels[clock::_5_edge + clock::_4_edge + clock::_3_edge + clock::_2_edge + clock::_1_edge + clk1._0()].push(
-        evt->_handle);
-    } else if (clk1._1() != clk2._1()) {
-      _wheels[clock::_5_edge + clock::_4_edge + clock::_3_edge + clock::_2_edge + clk1._1()].push(evt->_handle);
-    } else if (clk1._2() != clk2._2()) {
-      _wheels[clock::_5_edge + clock::_4_edge + clock::_3_edge + clk1._2()].push(evt->_handle);
-    } else if (clk1._3() != clk2._3()) {
-      _wheels[clock::_5_edge + clock::_4_edge + clk1._3()].push(evt->_handle);
-    } else if (clk1._4() != clk2._4()) {
-      _wheels[clock::_5_edge + clk1._4()].push(evt->_handle);
-    } else {
-      _wheels[clk1._5()].push(evt->_handle);
-    }
+  // 按累计耗时取前 n 个 tag
+  std::vector<slow_callback_stat> top(std::size_t n) const {
+    std::vector<slow_callback_stat> result;
+    result.reserve(_slow.size());
+    for (const auto &[_, stat] : _slow)
+      result.push_back(stat);
+    std::sort(result.begin(), result.end(),
+      [](const slow_callback_stat &lhs, const slow_callback_stat &rhs) { return lhs._total > rhs._total; });
+    if (result.size() > n)
+      result.resize(n);
+    return result;
   }
 
-  inline void step_list(std::queue<timer_handle> &lst) {
-    while (true) {
-      std::shared_ptr<event_interface> evt = nullptr;
-      {
-        std::scoped_lock<mutex_tt> lock(_mutex);
-        if (lst.empty())
-          break;
-        auto handle = lst.front();
-        lst.pop();
+  time_duration max_lateness() const {
+    return _max_lateness;
+  }
+};
 
-        const auto iter_evt = _events.find(handle);
-        if (iter_evt == _events.end())
-          continue;
+// 时间源：系统时钟
+struct system_time {
+  static constexpr bool is_virtual = false;
 
-        evt = iter_evt->second;
-      }
+  time64_t now() const noexcept {
+    return tick();
+  }
+};
 
-      if (evt && evt->_next == _tick) {
-        if (evt->_round) {
-          if (evt->_callback)
-            evt->_callback(evt->_handle);
-          {
-            std::scoped_lock<mutex_tt> lock(_mutex);
-            if (_events.find(evt->_handle) == _events.end()) {
-              continue;
-            }
-          }
-          evt->_round -= 1;
-        }
+/**
+ * \brief 时间源：虚拟时钟，只由 timer_wheel::advance_to 推进
+ * 用于仿真、压测回放：跳过空闲的 tick，几天的定时器活动几秒内跑完
+ */
+class virtual_time {
+ private:
+  time64_t _now;
 
-        if (evt->_round == 0ull) {
-          {
-            std::scoped_lock<mutex_tt> lock(_mutex);
-            _events.erase(evt->_handle);
-          }
+ public:
+  static constexpr bool is_virtual = true;
 
-          if (evt->_stopped_callback)
-            evt->_stopped_callback(evt);
-          continue;
-        }
+  explicit virtual_time(time64_t start = tick()) noexcept : _now(start) {}
 
-        evt->next();
-      }
-      {
-        std::scoped_lock<mutex_tt> lock(_mutex);
-        submit_unsafe(evt);
-      }
-    }
+  time64_t now() const noexcept {
+    return _now;
+  }
+
+  void set(time64_t now) noexcept {
+    _now = now;
   }
 };
 
+/**
+ * \brief add 的可选参数，默认值与不传一致
+ */
+// 同一 tick 内的触发优先级：高通道先触发，预算不足时低通道可推迟
+enum class timer_lane : uint8_t {
+  low = 0,     // 日志、表现类
+  normal = 1,  // 默认
+  high = 2,    // 战斗、冷却等时延敏感
+};
+static constexpr std::size_t lane_count = 3;
+
+// 同周期定时器的打散方式：每个定时器在窗口内取一个相位，首次和每次重排都落在 tick % 窗口 == 相位 上
+enum class spread_mode : uint8_t {
+  none = 0,
+  hashed = 1,  // 按 owner（没有时按槽位下标）哈希，同一 owner 的定时器同相位
+  random = 2,  // 每个定时器随机
+};
+
+// 周期定时器的重排方式
+enum class period_mode : uint8_t {
+  fixed_delay = 0,  // 下次 = 触发时的 now() + period，回调耗时和 tick 延迟会累积
+  fixed_rate = 1,   // 下次 = 上次到期 + period，不读时钟、不漂移；周期按 tick 四舍五入
+};
+
+// fixed_rate 卡顿后错过了多个周期时的处理
+enum class catch_up_policy : uint8_t {
+  once = 0,   // 只补一次，之后回到原来的节拍
+  burst = 1,  // 连续补，最多 _burst_limit 次
+  skip = 2,   // 错过的整周期直接丢掉（计入轮次），只为当前周期触发一次，之后回到节拍
+};
+
+struct timer_options {
+  time_duration _slack{0};  // 容差：到期时间可推迟到 [deadline, deadline + slack] 内对齐的 tick，与同类定时器合并触发
+  // 分辨率：到期时间向上取整到不超过它的最粗层格子（1/16/256/4096/262144/16777216 个 tick），
+  // 对齐后直接在那一层触发，不再级联到更细的层；0 表示按 precision_tt
+  // 按 tick 数取格子：precision 1 时 10ms 不足 16 tick 等于不对齐，100ms -> 16、1s -> 256、5s -> 4096，见 resolution_test.cpp
+  time_duration _resolution{0};
+  timer_lane _lane = timer_lane::normal;  // 优先级通道
+  uint64_t _owner = 0;                    // 所属分组（如实体 id），stop_group 一次停掉；0 表示不分组
+  uint32_t _affinity = affinity_none;     // 回调投递的目标线程（alert_affinity 按它对线程数取模）
+  // 打散窗口：到期时间推迟到 [deadline, deadline + spread) 内相位对应的 tick，大批同周期定时器不再挤在同一 tick
+  // 设置后忽略 _slack / _resolution
+  time_duration _spread{0};
+  spread_mode _spread_mode = spread_mode::hashed;
+  period_mode _period_mode = period_mode::fixed_delay;
+  catch_up_policy _catch_up = catch_up_policy::once;
+  uint8_t _burst_limit = 4;  // catch_up_policy::burst 时一次卡顿最多补触发的次数（含本次）
+};
+
+// execute 的工作量上限，任一条件满足即停，下次 execute 从停下的位置继续
+// _exempt 以上（含）的通道不受预算限制：预算用完后不再停在桶中间，而是继续推进 tick，
+// 只触发豁免通道，其余到期的定时器挂到推迟队列，下次 execute 先（在预算内）补触发
+struct execute_budget {
+  std::size_t _callbacks = std::numeric_limits<std::size_t>::max();  // 最多触发的回调数
+  std::chrono::steady_clock::time_point _deadline = std::chrono::steady_clock::time_point::max();  // 截止时间
+  std::size_t _exempt = lane_count;  // 不受预算限制的最低通道，lane_count 表示都受限
+};
+
+struct execute_result {
+  std::size_t _fired = 0;        // 本次触发的回调数
+  bool _finished = true;         // 是否已追上当前时间且没有推迟的定时器
+  time64_t _ticks_behind = 0;    // 未处理完的 tick 数（含停下的那一格）
+  std::size_t _bucket_left = 0;  // 停下的桶里剩余的句柄数（含待级联、已停止）
+  std::size_t _deferred = 0;     // 推迟队列里等待补触发的定时器
+};
+
+/**
+ * \brief 定时器快照格式
+ * snapshot_header 后紧跟 _count 条定长 snapshot_record，整体 8 字节对齐，可直接 mmap 后交给 restore
+ * 时间统一存毫秒，恢复到不同精度的 timer_wheel 也可以
+ */
+struct snapshot_header {
+  uint32_t _magic = 0x4E535754;  // "TWSN"
+  uint16_t _version = 2;         // 1 只有到期时间、周期、轮次和 payload，恢复时其余选项取默认值
+  uint16_t _record_size = 0;
+  uint64_t _count = 0;
+  time64_t _saved = 0;  // 保存时的 tick()
+};
+
+struct snapshot_record {
+  uint32_t _type = 0;       // 回调类型 id
+  uint32_t _size = 0;       // payload 字节数
+  time64_t _next = 0;       // 绝对到期时间（ms）
+  time64_t _period = 0;     // 间隔（ms）
+  uint64_t _round = 0;      // 剩余轮次
+  unsigned char _payload[payload_capacity] = {};
+  // 以下为 version 2 新增：timer_options 里的调度选项
+  uint64_t _owner = 0;                 // 所属分组
+  uint32_t _slack = 0;                 // 容差（ms）；打散时为窗口
+  uint32_t _phase = 0;                 // 打散相位（ms），恢复后仍落在原来的相位上
+  uint32_t _resolution = 0;            // 分辨率（ms）
+  uint32_t _affinity = affinity_none;  // 回调投递的目标线程
+  uint8_t _lane = 1;                   // 优先级通道
+  uint8_t _spread = 0;                 // 打散方式，见 spread_mode
+  uint8_t _rate = 0;                   // 0 为 fixed_delay；否则 fixed_rate，值为 1 + 追赶上限
+  uint8_t _reserved[5] = {};
+};
+
+static constexpr std::size_t snapshot_record_v1 = offsetof(snapshot_record, _owner);
+
+/**
+ * \brief 负载 trace 格式
+ * trace_header 后紧跟 _count 条定长 trace_record，按发生顺序排列；replay_test.cpp 在 virtual_time 下按它回放
+ * 时间都是毫秒，受记录时 precision 的取整影响，想拿原始时长用 timer_wheel<1> 记录
+ */
+struct trace_header {
+  uint32_t _magic = 0x52545754;  // "TWTR"
+  uint16_t _version = 2;  // 1 没有调度选项，回放时取默认值
+  uint16_t _record_size = 0;
+  uint64_t _count = 0;
+  time64_t _start = 0;      // 开始记录时的 now()
+  uint64_t _precision = 0;  // 记录时的 precision
+};
+
+enum class trace_op : uint8_t {
+  add = 0,
+  stop = 1,        // stop / stop_group 真正停掉的
+  reschedule = 2,  // 周期 / cron 定时器触发后重排
+  fire = 3,
+};
+
+struct trace_record {
+  uint32_t _at = 0;        // 相对 _start 的毫秒
+  uint32_t _id = 0;        // 槽位下标：同一时刻存活的定时器互不相同，回收后会复用
+  uint32_t _duration = 0;  // add / reschedule：距到期的毫秒；fire：触发延迟
+  uint32_t _period = 0;    // 间隔（ms）
+  uint32_t _round = 0;     // 剩余轮次，超出 32 位记为 UINT32_MAX
+  trace_op _op = trace_op::add;
+  event_kind _kind = event_kind::custom;
+  uint8_t _lane = 0;
+  uint8_t _spread = 0;  // 打散方式，见 spread_mode（version 1 里恒为 0 的保留字节）
+  // 以下为 version 2 新增：add / reschedule 时的 timer_options
+  uint32_t _slack = 0;       // 容差（ms）；打散时为窗口
+  uint32_t _resolution = 0;  // 分辨率（ms）
+  uint8_t _rate = 0;         // 0 为 fixed_delay；否则 fixed_rate，值为 1 + 追赶上限
+  uint8_t _reserved[3] = {};
+};
+
+static constexpr std::size_t trace_record_v1 = offsetof(trace_record, _slack);
+
+/**
+ * \brief 负载记录器，见 timer_wheel::trace_on
+ * 关闭时每个记录点只多一次 relaxed load；开启后每条一次自旋锁 + push_back，可以在任意线程追加
+ */
+class workload_recorder {
+ private:
+  spin_mutex _lock;
+  std::atomic<bool> _active = false;
+  time64_t _start = 0;
+  std::vector<trace_record> _records;
+
+  static uint32_t clamp(uint64_t value) {
+    return static_cast<uint32_t>(std::min<uint64_t>(value, UINT32_MAX));
+  }
+
+ public:
+  bool active() const {
+    return _active.load(std::memory_order_relaxed);
+  }
+
+  void start(time64_t now, std::size_t reserve) {
+    std::scoped_lock<spin_mutex> lock(_lock);
+    _records.clear();
+    _records.reserve(reserve);
+    _start = now;
+    _active.store(true, std::memory_order_release);
+  }
+
+  void stop() {
+    _active.store(false, std::memory_order_release);
+  }
+
+  // precision 用来把 tick 换算回毫秒
+  static trace_record make(trace_op op, const event_interface &evt, uint64_t precision, time64_t duration = 0) {
+    trace_record record;
+    record._id = handle_gen::index(evt._handle);
+    record._duration = clamp(duration);
+    record._period = clamp(evt._period);
+    record._round = clamp(evt._round);
+    record._op = op;
+    record._kind = evt._kind;
+    record._lane = evt._lane;
+    record._spread = evt._spread;
+    record._slack = clamp(evt._slack * precision);
+    record._resolution = evt._resolution ? clamp((uint64_t(1) << evt._resolution) * precision) : 0;
+    record._rate = evt._rate;
+    return record;
+  }
+
+  void append(time64_t now, trace_record record) {
+    alloc_guard pause(false);
+    std::scoped_lock<spin_mutex> lock(_lock);
+    if (!active())
+      return;
+    record._at = clamp(now > _start ? now - _start : 0);
+    _records.push_back(record);
+  }
+
+  std::size_t save(std::vector<unsigned char> &out, uint64_t precision) {
+    std::scoped_lock<spin_mutex> lock(_lock);
+    trace_header header;
+    header._record_size = sizeof(trace_record);
+    header._count = _records.size();
+    header._start = _start;
+    header._precision = precision;
+
+    const auto offset = out.size();
+    out.resize(offset + sizeof(trace_header) + _records.size() * sizeof(trace_record));
+    std::memcpy(out.data() + offset, &header, sizeof(trace_header));
+    if (!_records.empty())
+      std::memcpy(out.data() + offset + sizeof(trace_header), _records.data(), _records.size() * sizeof(trace_record));
+    return _records.size();
+  }
+};
+
+template <uint64_t precision_tt = 10, class mutex_tt = empty_mutex, class alert = alert_default,
+  class metrics_tt = metrics_empty, class time_tt = system_time>
+class timer_wheel {
+ private:
+  mutex_tt _mutex;
+  metrics_tt _metrics;
+  time_tt _time;
+  static constexpr time64_t _precision = precision_tt;  // 精度
+
+  // 槽位里当前这一代事件的状态，与 30 位代数合成一个原子字：stop 不加锁，CAS 到 cancelled 即可
+  enum class slot_state : uint32_t {
+    pending = 0,    // 等待到期
+    firing = 1,     // 回调执行中（仍可 stop）
+    cancelled = 2,  // 已 stop，等持锁方回收
+    done = 3,       // 轮次用完等回收，或空闲槽位
+  };
+
+  static constexpr uint32_t state_word(uint32_t generation, slot_state state) {
+    return (generation << 2) | static_cast<uint32_t>(state);
+  }
+  static constexpr uint32_t word_generation(uint32_t word) {
+    return word >> 2;
+  }
+  static constexpr slot_state word_state(uint32_t word) {
+    return static_cast<slot_state>(word & 3);
+  }
+
+  struct event_slot {
+    std::atomic<uint32_t> _state = state_word(1, slot_state::done);  // 代数 << 2 | slot_state，回收时代数 +1
+    uint32_t _link = handle_gen::unlinked;            // 桶内 FIFO 链 / 空闲链表，unlinked 表示不在桶上
+    uint32_t _owner_prev = handle_gen::invalid_next;  // 同 owner 的双向链
+    uint32_t _owner_next = handle_gen::invalid_next;
+    std::atomic<time64_t> _due = 0;                   // 当前到期 tick，stop 不加锁时算剩余时间
+    std::atomic<uint32_t> _reclaim = handle_gen::unlinked;  // 待回收栈的下一项，unlinked 表示不在栈上
+    std::shared_ptr<event_interface> _event = nullptr;
+  };
+
+  /**
+   * \brief 分段的槽位表：定长段 + 目录，扩容不搬动已有槽位
+   * 增长在锁内；find 不加锁，stop 用它按句柄访问状态字。目录扩容后旧目录保留到析构，不加锁的读者拿到旧目录也安全
+   */
+  class slot_table {
+   private:
+    static constexpr uint32_t _segment_bits = 6;  // 每段 64 个槽位，只有几个定时器的实例不占满一大段
+    static constexpr uint32_t _segment_mask = (1u << _segment_bits) - 1;
+
+    std::vector<std::unique_ptr<event_slot[]>> _segments;
+    std::vector<std::unique_ptr<event_slot *[]>> _directories;  // 当前目录在最后
+    std::atomic<event_slot **> _directory = nullptr;
+    std::size_t _directory_capacity = 0;
+    std::atomic<uint32_t> _size = 0;
+    uint32_t _capacity = 0;
+
+    void grow() {
+      const auto segment = _segments.size();
+      if (segment == _directory_capacity) {
+        const auto capacity = std::max<std::size_t>(_directory_capacity * 2, 4);
+        auto directory = std::make_unique<event_slot *[]>(capacity);
+        for (std::size_t i = 0; i < segment; ++i)
+          directory[i] = _segments[i].get();
+        _directory.store(directory.get(), std::memory_order_release);
+        _directories.emplace_back(std::move(directory));
+        _directory_capacity = capacity;
+      }
+      _segments.emplace_back(std::make_unique<event_slot[]>(std::size_t(1) << _segment_bits));
+      _directories.back()[segment] = _segments.back().get();
+      _capacity += 1u << _segment_bits;
+    }
+
+   public:
+    // step_list 不持锁也会访问，目录要和 grow 的发布配对
+    event_slot &operator[](uint32_t index) {
+      return _directory.load(std::memory_order_acquire)[index >> _segment_bits][index & _segment_mask];
+    }
+
+    uint32_t size() const {
+      return _size.load(std::memory_order_relaxed);
+    }
+
+    void reserve(std::size_t n) {
+      while (_capacity < n && _capacity < handle_gen::overflowed)
+        grow();
+    }
+
+    // 锁内调用，返回新槽位下标
+    uint32_t emplace_back() {
+      const auto index = size();
+      if (index == _capacity)
+        grow();
+      _size.store(index + 1, std::memory_order_release);
+      return index;
+    }
+
+    // 不加锁访问，越界返回 nullptr
+    event_slot *find(uint32_t index) {
+      if (index >= _size.load(std::memory_order_acquire))
+        return nullptr;
+      return &_directory.load(std::memory_order_acquire)[index >> _segment_bits][index & _segment_mask];
+    }
+  };
+
+  // 侵入式桶：链表节点就是 event_slot，挂桶/摘桶不分配内存
+  struct lane_list {
+    uint32_t _head = handle_gen::invalid_next;
+    uint32_t _tail = handle_gen::invalid_next;
+  };
+
+  // 每个桶按通道分 FIFO，摘桶时高通道优先
+  struct bucket {
+    std::array<lane_list, lane_count> _lanes{};
+    uint32_t _size = 0;
+  };
+
+  // 时间轮：最细层内嵌；更粗的层第一次切到时间轮时才分配（小根堆模式只用到最细层），之后不再移动
+  // _coarse 按 level_offsets 的下标减去 clock::_5_edge 访问，execute 线程不加锁读
+  std::array<bucket, clock::_5_edge> _fine{};
+  std::unique_ptr<bucket[]> _coarse_buckets;
+  std::atomic<bucket *> _coarse = nullptr;
+  slot_table _slots;                               // 句柄下标 -> 事件
+  uint32_t _free_slot = handle_gen::invalid_next;  // 空闲槽位链表头
+  // stop 没拿到锁时把槽位压到这个无锁栈上，下次 execute 或下一个 stop 持锁时回收
+  std::atomic<uint32_t> _cancelled{handle_gen::invalid_next};
+  bool _reserved = false;                          // reserve() 后热路径不应再分配
+
+  time64_t _tick = _time.now() / _precision;  // 扳手时钟
+  time64_t _tick_now = _tick;                  // 本次 execute 要追到的 tick，fixed_rate 据此判断错过的周期
+
+  std::unique_ptr<callback_profiler> _profiler;  // 慢回调检测，默认关闭
+  workload_recorder _recorder;                   // 负载记录，默认关闭
+
+  event_pool *_pool = new event_pool();  // 事件对象池，析构时 detach
+
+  std::vector<typed_callback> _typed;  // 类型 id -> 回调，见 register_type
+
+  // 批量投递：同一类型在一个 tick 里到期的定时器攒成连续数组，tick 结束时调用一次，见 register_batch
+  // 这类事件的 _kind 为 event_kind::batch，step_list 据此识别，不逐个调用
+  struct batch_sink {
+    std::function<void(const timer_handle *, const void *, std::size_t)> _handler;
+    std::size_t _stride = 0;  // payload 大小
+    std::vector<timer_handle> _handles;
+    std::vector<unsigned char> _payloads;
+  };
+  std::vector<batch_sink> _sinks;     // 类型 id -> 批量回调
+  std::vector<uint32_t> _dirty_sinks;  // 本 tick 攒了数据的类型
+
+  // slack 合并统计（仅 metrics 开启时）：当前 tick 已触发的不同原始到期 tick，有序，容量按历史峰值保留
+  time64_t _wakeup_tick = -1;
+  std::vector<time64_t> _wakeup_origins;
+
+  // execute(budget) 的预算，由 execute 在栈上创建、一路传给 step_list；回调里重入 execute 各用各的
+  struct budget_state {
+    std::size_t _left = std::numeric_limits<std::size_t>::max();
+    std::chrono::steady_clock::time_point _deadline = std::chrono::steady_clock::time_point::max();
+    bool _timed = false;
+    bool _hit = false;
+    std::size_t _fired = 0;
+    std::size_t _bucket_left = 0;
+    std::size_t _exempt = lane_count;
+  };
+
+  bucket _deferred;  // 预算不足被推迟的到期定时器
+
+  // step_list 一次摘下的批次
+  enum class batch_action : uint8_t {
+    pending,  // 未处理，提交时放回桶头
+    cascade,  // 未到期，级联到更细的层
+    rearm,    // 已触发，周期重排
+    defer,    // 预算不足，挂到推迟队列
+    finish,   // 轮次用完
+    drop,     // 已被 stop，槽位还在就回收
+  };
+  struct batch_item {
+    std::shared_ptr<event_interface> _event;
+    batch_action _action;
+    uint64_t _round = 0;  // rearm / finish：触发后的剩余轮次，提交阶段写回
+    time64_t _now = 0;    // rearm：触发完成时的 now()，fixed_delay 据此重排
+  };
+  static constexpr std::size_t batch_limit = 256;  // 每批上限，回调里 add 到同一桶的也能在后续批次处理
+  std::vector<batch_item> _batch;
+
+  std::unordered_map<uint64_t, uint32_t> _owners;  // owner -> 链表头槽位
+
+  // 超出 _horizon 或不在时间轮当前这一圈的定时器：按到期 tick 的小根堆，可以迁入时再 submit
+  // 槽位不挂桶，stop 后直接回收，迁入时按代数跳过；同一 tick 按入堆顺序，保持桶内 FIFO
+  struct overflow_entry {
+    time64_t _next;
+    uint64_t _seq;
+    uint32_t _index;
+    uint32_t _generation;
+  };
+  static constexpr time64_t wheel_ticks = time64_t(1) << clock::_span_bits;
+  // 最粗层一格；horizon 比一圈少一格时，下一圈的定时器到 next - horizon 就能放进最粗层已经走过的格子，
+  // 逐个迁入，不会在每圈开头集中迁移
+  static constexpr time64_t rotation_granule = time64_t(1) << level_shifts[level_count - 1];
+  static constexpr time64_t max_horizon = wheel_ticks - rotation_granule;
+  std::vector<overflow_entry> _overflow;
+  uint64_t _overflow_seq = 0;
+  std::size_t _overflow_dead = 0;  // 堆里已回收的条目数，过半时整理
+  static constexpr std::size_t overflow_slack = 64;
+  time64_t _horizon = max_horizon;
+  std::atomic<time64_t> _overflow_tick = std::numeric_limits<time64_t>::max();  // 堆顶可以迁入的 tick
+
+  // 自适应：存活定时器少时只用 overflow 堆（horizon 视为 0），execute 直接跳到下一个要处理的 tick
+  std::size_t _count = 0;  // 存活定时器数
+  std::size_t _sparse_below = 64;
+  std::size_t _dense_above = 256;
+  std::atomic<bool> _sparse = true;
+
+  uint64_t _spread_seed = 0;  // spread_mode::random 的状态（splitmix64），固定起点便于复现
+
+  alert _alert;  // 回调投递策略
+
+ public:
+  timer_wheel() = default;
+
+  // 指定时间源，例如从固定起点开始的 virtual_time，便于仿真结果复现
+  explicit timer_wheel(const time_tt &time) : _time(time), _tick(_time.now() / _precision), _tick_now(_tick) {}
+
+  timer_wheel(const timer_wheel &) = delete;
+  timer_wheel &operator=(const timer_wheel &) = delete;
+
+  ~timer_wheel() {
+    _pool->detach();
+  }
+
+  template <class Rep, class Period>
+  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
+    timer_stopped_callback &&stopped_callback = nullptr, const time_duration &period = time_duration::zero(),
+    const int64_t round = 0) {
+    return add(when, std::forward<timer_callback>(callback), timer_options(),
+      std::forward<timer_stopped_callback>(stopped_callback), period, round);
+  }
+
+  template <class Rep, class Period>
+  inline timer_handle add(const std::chrono::duration<Rep, Period> &when, timer_callback &&callback,
+    const timer_options &options, timer_stopped_callback &&stopped_callback = nullptr,
+    const time_duration &period = time_duration::zero(), const int64_t round = 0) {
+    alloc_guard guard(_reserved);
+    std::shared_ptr<event_interface> event_ = event_custom<_precision>::create(
+      deadline(when),
+      period.count(), round, std::forward<timer_callback>(callback),
+      std::forward<timer_stopped_callback>(stopped_callback), pool_allocator<event_custom<_precision>>(_pool));
+
+    if (event_ == nullptr) {
+      return handle_gen::invalid_handle;
+    }
+
+    apply_options(*event_, options);
+    return insert(event_);
+  }
+
+  inline timer_handle add(
+    const std::string &cron_str, timer_callback &&callback, timer_stopped_callback &&stopped_callback = nullptr) {
+    std::shared_ptr<event_interface> event_ = event_crontab<_precision>::create(cron_str,
+      std::forward<timer_callback>(callback), std::forward<timer_stopped_callback>(stopped_callback),
+      pool_allocator<event_crontab<_precision>>(_pool), now());
+
+    if (event_ == nullptr) {
+      return handle_gen::invalid_handle;
+    }
+
+    return insert(event_);
+  }
+
+  inline timer_handle add(
+    std::string &&cron_str, timer_callback &&callback, timer_stopped_callback &&stopped_callback = nullptr) {
+    std::shared_ptr<event_interface> event_ = event_crontab<_precision>::create(cron_str,
+      std::forward<timer_callback>(callback), std::forward<timer_stopped_callback>(stopped_callback),
+      pool_allocator<event_crontab<_precision>>(_pool), now());
+
+    if (event_ == nullptr) {
+      return handle_gen::invalid_handle;
+    }
+
+    return insert(event_);
+  }
+
+  /**
+   * \brief 预留容量，之后 add/stop/execute 不再分配堆内存
+   * n_timers 需覆盖同时存活的定时器数，包括已 stop 但还未被 execute 扫过的槽位
+   * overflow 堆里的死条目过半才整理，堆最多是存活条目的两倍，按 2 * n_timers 预留
+   * n_cold 为带 stopped_callback 或 remark 的定时器数
+   * 不在范围内的分配：超出 std::function 小对象缓冲的回调（由调用方构造）、cron 定时器、profile()
+   */
+  inline void reserve(std::size_t n_timers, std::size_t n_cold = 0) {
+    // 探测一次 event_custom 控制块的实际大小
+    event_custom<_precision>::create(0, 0, 0, nullptr, nullptr, pool_allocator<event_custom<_precision>>(_pool));
+    _pool->reserve(_pool->last_size(), n_timers);
+    if (n_cold)
+      _pool->reserve(sizeof(event_cold), n_cold);
+
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    if (n_timers > _dense_above)
+      grow_wheels_unsafe();
+    _slots.reserve(n_timers);
+    _batch.reserve(batch_limit);
+    _overflow.reserve(2 * n_timers + overflow_slack);
+    _reserved = true;
+  }
+
+  /**
+   * \brief 时间轮只放 horizon 以内的定时器，更远的先放在 overflow 小根堆里，到 horizon 以内时迁入
+   * 默认也是上限：时间轮一圈（1 << clock::_span_bits 个 tick）减去最粗层一格，precision 1ms 时约 12.2 天
+   * 调小可以让只有少量远期定时器的场景不在粗层里反复级联
+   */
+  template <class Rep, class Period>
+  inline void horizon(const std::chrono::duration<Rep, Period> &span) {
+    const auto ticks = std::chrono::duration_cast<time_duration>(span).count() / _precision;
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    _horizon = std::min<time64_t>(std::max<decltype(ticks)>(ticks, 0), max_horizon);
+    update_overflow_unsafe();
+  }
+
+  /**
+   * \brief 存活定时器少于 sparse_below 时只用小根堆，execute 不再逐 tick 扫桶；超过 dense_above 切回时间轮
+   * 两个阈值之间保持当前模式，避免在阈值附近来回迁移；句柄和 add/stop/execute 的行为不受模式影响
+   * sparse_below 为 0 时始终用时间轮
+   */
+  inline void adaptive(std::size_t sparse_below, std::size_t dense_above) {
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    _sparse_below = sparse_below;
+    _dense_above = std::max(sparse_below, dense_above);
+    // reserve() 之后 add 里切到时间轮不应再分配
+    if (_reserved)
+      grow_wheels_unsafe();
+    switch_unsafe(_count < _sparse_below);
+  }
+
+  /**
+   * \brief 注册可快照的回调类型；启动时、第一次 add_typed/restore 之前调用，之后不再修改
+   */
+  template <class payload_tt>
+  inline void register_type(uint32_t type, std::function<void(timer_handle, const payload_tt &)> &&callback) {
+    static_assert(std::is_trivially_copyable_v<payload_tt>, "payload must be POD");
+    static_assert(sizeof(payload_tt) <= payload_capacity, "payload too large");
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    if (_typed.size() <= type)
+      _typed.resize(type + 1);
+    _typed[type] = [callback = std::move(callback)](timer_handle handle, const void *payload) {
+      payload_tt value;
+      std::memcpy(&value, payload, sizeof(payload_tt));
+      callback(handle, value);
+    };
+  }
+
+  /**
+   * \brief 注册批量回调：该类型的定时器在同一 tick 到期的，收齐后以 (handles, payloads, count) 调用一次
+   * 与 register_type 共用类型 id 空间，同一 id 二选一；定时器仍用 add_typed 添加、可以快照
+   * 在 execute 线程里直接调用（不经 alert），同一 tick 内排在逐个触发的回调之后
+   */
+  template <class payload_tt>
+  inline void register_batch(
+    uint32_t type, std::function<void(const timer_handle *, const payload_tt *, std::size_t)> &&callback) {
+    static_assert(std::is_trivially_copyable_v<payload_tt>, "payload must be POD");
+    static_assert(sizeof(payload_tt) <= payload_capacity, "payload too large");
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    if (_sinks.size() <= type)
+      _sinks.resize(type + 1);
+    _sinks[type]._stride = sizeof(payload_tt);
+    // 缓冲来自 operator new，按 max_align_t 对齐，步长为 sizeof(payload_tt)，可以直接当数组用，不再拷贝
+    static_assert(alignof(payload_tt) <= alignof(std::max_align_t), "payload over-aligned");
+    _sinks[type]._handler = [callback = std::move(callback)](
+                              const timer_handle *handles, const void *payloads, std::size_t count) {
+      callback(handles, static_cast<const payload_tt *>(payloads), count);
+    };
+  }
+
+  // 按类型 id 添加，只有这类定时器会进入 snapshot
+  template <class payload_tt, class Rep, class Period>
+  inline timer_handle add_typed(const std::chrono::duration<Rep, Period> &when, uint32_t type,
+    const payload_tt &payload, const time_duration &period = time_duration::zero(), const int64_t round = 0) {
+    return add_typed(when, type, payload, timer_options(), period, round);
+  }
+
+  // options 随快照保存，restore 后仍然生效
+  template <class payload_tt, class Rep, class Period>
+  inline timer_handle add_typed(const std::chrono::duration<Rep, Period> &when, uint32_t type,
+    const payload_tt &payload, const timer_options &options, const time_duration &period = time_duration::zero(),
+    const int64_t round = 0) {
+    static_assert(std::is_trivially_copyable_v<payload_tt>, "payload must be POD");
+    static_assert(sizeof(payload_tt) <= payload_capacity, "payload too large");
+    if (!typed_registered(type))
+      return handle_gen::invalid_handle;
+
+    alloc_guard guard(_reserved);
+    std::shared_ptr<event_interface> event_ = event_typed<_precision>::create(deadline(when),
+      period.count(), round, type, &payload, sizeof(payload_tt), &_typed,
+      pool_allocator<event_typed<_precision>>(_pool));
+
+    if (event_ == nullptr) {
+      return handle_gen::invalid_handle;
+    }
+    if (batched(type))
+      event_->_kind = event_kind::batch;
+
+    apply_options(*event_, options);
+    return insert(event_);
+  }
+
+  // 把所有 add_typed 定时器写成 snapshot_header + snapshot_record[]，返回写入条数
+  inline std::size_t snapshot(std::vector<unsigned char> &out) {
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    snapshot_header header;
+    header._record_size = sizeof(snapshot_record);
+    header._saved = now();
+
+    const auto offset = out.size();
+    out.resize(offset + sizeof(snapshot_header));
+    for (uint32_t i = 0; i < _slots.size(); ++i) {
+      const auto &slot = _slots[i];
+      if (slot._event == nullptr ||
+          (slot._event->_kind != event_kind::typed && slot._event->_kind != event_kind::batch) ||
+          !armed(slot._state.load(std::memory_order_acquire)))
+        continue;
+      const auto *evt = static_cast<const event_typed<_precision> *>(slot._event.get());
+      snapshot_record record;
+      record._type = evt->_type;
+      record._size = evt->_size;
+      // 存去掉 slack/resolution 推迟前的到期时间，恢复时重新对齐
+      record._next = rate_origin(*evt) * _precision;
+      record._period = evt->_period;
+      record._round = evt->_round;
+      std::memcpy(record._payload, evt->_payload.data(), payload_capacity);
+      record._owner = evt->_owner;
+      record._slack = static_cast<uint32_t>(std::min<time64_t>(evt->_slack * _precision, UINT32_MAX));
+      record._phase = evt->_spread ? static_cast<uint32_t>(std::min<time64_t>(evt->_shift * _precision, UINT32_MAX)) : 0;
+      record._resolution = evt->_resolution ? static_cast<uint32_t>((time64_t(1) << evt->_resolution) * _precision) : 0;
+      record._affinity = evt->_affinity;
+      record._lane = evt->_lane;
+      record._spread = evt->_spread;
+      record._rate = evt->_rate;
+
+      const auto pos = out.size();
+      out.resize(pos + sizeof(snapshot_record));
+      std::memcpy(out.data() + pos, &record, sizeof(snapshot_record));
+      header._count += 1;
+    }
+    std::memcpy(out.data() + offset, &header, sizeof(snapshot_header));
+    return header._count;
+  }
+
+  inline bool snapshot(const std::string &path) {
+    std::vector<unsigned char> data;
+    snapshot(data);
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+      return false;
+    const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && ok;
+  }
+
+  /**
+   * \brief 从快照批量恢复，data 可以是 mmap 的文件
+   * 到期时间按绝对时间恢复，停机期间已过期的在下一次 execute 触发；类型未注册的记录跳过
+   * owner、lane、affinity、fixed_rate、slack、resolution、打散相位随快照恢复（version 1 的快照取默认值）；
+   * 停止回调、remark 不在快照里
+   * 按记录条数一次性预留槽位、事件块和 overflow 堆，整批在一次加锁内插入
+   * handles 非空时按记录顺序输出新句柄（跳过的记录为 invalid_handle）
+   * 返回恢复条数，格式不对返回 0
+   */
+  inline std::size_t restore(const void *data, std::size_t size, std::vector<timer_handle> *handles = nullptr) {
+    snapshot_header header;
+    if (size < sizeof(snapshot_header))
+      return 0;
+    std::memcpy(&header, data, sizeof(snapshot_header));
+    const std::size_t record_size = header._version == 1 ? snapshot_record_v1 : sizeof(snapshot_record);
+    if (header._magic != snapshot_header()._magic || header._version < 1 ||
+        header._version > snapshot_header()._version || header._record_size != record_size ||
+        header._count > (size - sizeof(snapshot_header)) / record_size)
+      return 0;
+
+    const auto *records = static_cast<const unsigned char *>(data) + sizeof(snapshot_header);
+    if (handles)
+      handles->reserve(handles->size() + header._count);
+
+    // 探测一次 event_typed 控制块的实际大小
+    event_typed<_precision>::create(0, 0, 0, 0, nullptr, 0, &_typed, pool_allocator<event_typed<_precision>>(_pool));
+    const auto block_size = _pool->last_size();
+
+    std::size_t restored = 0;
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    _pool->reserve(block_size, _count + header._count);
+    _slots.reserve(_slots.size() + header._count);
+    _overflow.reserve(_overflow.size() + header._count);
+    for (uint64_t i = 0; i < header._count; ++i) {
+      snapshot_record record;
+      std::memcpy(&record, records + i * record_size, record_size);
+
+      std::shared_ptr<event_interface> event_ = nullptr;
+      if (typed_registered(record._type)) {
+        event_ = event_typed<_precision>::create(record._next / _precision, record._period, record._round,
+          record._type, record._payload, record._size, &_typed, pool_allocator<event_typed<_precision>>(_pool));
+        if (event_ && batched(record._type))
+          event_->_kind = event_kind::batch;
+      }
+      if (event_ == nullptr) {
+        if (handles)
+          handles->push_back(handle_gen::invalid_handle);
+        continue;
+      }
+      const bool spread = restore_options(*event_, record);
+      const auto handle = insert_unsafe(event_, spread);
+      if (handles)
+        handles->push_back(handle);
+      restored += 1;
+    }
+    return restored;
+  }
+
+  inline std::size_t restore(const std::string &path, std::vector<timer_handle> *handles = nullptr) {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+      return 0;
+    std::vector<unsigned char> data;
+    if (std::fseek(file, 0, SEEK_END) == 0) {
+      const auto size = std::ftell(file);
+      if (size > 0 && std::fseek(file, 0, SEEK_SET) == 0) {
+        data.resize(static_cast<std::size_t>(size));
+        data.resize(std::fread(data.data(), 1, data.size(), file));
+      }
+    }
+    std::fclose(file);
+    return restore(data.data(), data.size(), handles);
+  }
+
+  /**
+   * \brief 停止定时器，返回剩余时间；可以在任意线程调用，包括该定时器自己的回调里
+   * 不加锁：对槽位状态字做一次 CAS 即生效，之后不会再触发。能立即拿到锁时当场回收，
+   * stopped_callback 在调用线程执行；锁被占用时不等待，压到待回收栈上，由下次 execute（或下一个拿到锁的 stop）
+   * 回收并在那个线程执行 stopped_callback
+   */
+  inline time_duration stop(const timer_handle &handle) {
+    alloc_guard guard(_reserved);
+    auto *slot = _slots.find(handle_gen::index(handle));
+    if (slot == nullptr)
+      return time_duration(0);
+
+    const auto generation = handle_gen::generation(handle);
+    auto word = slot->_state.load(std::memory_order_acquire);
+    do {
+      if (word_generation(word) != generation || !armed(word))
+        return time_duration(0);
+    } while (!slot->_state.compare_exchange_weak(word, state_word(generation, slot_state::cancelled)));
+    _metrics.on_stop();
+    if (_recorder.active()) {
+      // 此后槽位可能被 execute 线程回收，只记句柄
+      trace_record record;
+      record._op = trace_op::stop;
+      record._id = handle_gen::index(handle);
+      _recorder.append(now(), record);
+    }
+
+    const auto tick_ = now();
+    const auto next_ = slot->_due.load(std::memory_order_relaxed) * _precision;
+
+    std::shared_ptr<event_interface> evt = nullptr;
+    std::vector<std::shared_ptr<event_interface>> reclaimed;
+    {
+      std::unique_lock<mutex_tt> lock(_mutex, std::try_to_lock);
+      if (!lock.owns_lock()) {
+        push_cancelled(*slot, handle_gen::index(handle));
+      } else {
+        // execute 线程可能已经回收
+        if (slot->_state.load(std::memory_order_relaxed) == state_word(generation, slot_state::cancelled)) {
+          evt = slot->_event;
+          release_unsafe(handle);
+        }
+        reclaim_cancelled_unsafe(reclaimed);
+      }
+    }
+
+    if (evt || !reclaimed.empty()) {
+      alloc_guard pause(false);
+      if (evt)
+        event_interface::stopped(evt);
+      for (const auto &item : reclaimed)
+        event_interface::stopped(item);
+    }
+
+    if (next_ >= tick_)
+      return time_duration(next_ - tick_);
+    return time_duration(0);
+  }
+
+  /**
+   * \brief 停掉 owner 名下的所有定时器（实体销毁时用），返回停止的个数
+   * 一次 map 查找后沿侵入式链表逐个摘除，stopped_callback 在解锁后依次触发
+   */
+  inline std::size_t stop_group(uint64_t owner) {
+    std::size_t count = 0;
+    std::vector<std::shared_ptr<event_interface>> stopped;
+    {
+      std::scoped_lock<mutex_tt> lock(_mutex);
+      const auto iter = _owners.find(owner);
+      if (iter == _owners.end())
+        return 0;
+      auto index = iter->second;
+      _owners.erase(iter);
+      while (index != handle_gen::invalid_next) {
+        auto &slot = _slots[index];
+        const auto next = slot._owner_next;
+        slot._owner_prev = handle_gen::invalid_next;
+        slot._owner_next = handle_gen::invalid_next;
+        index = next;
+
+        // 已被 stop 但还没回收的一并回收；轮次用完的留给 execute 线程
+        auto word = slot._state.load(std::memory_order_acquire);
+        while (armed(word) && !slot._state.compare_exchange_weak(word,
+                                state_word(word_generation(word), slot_state::cancelled), std::memory_order_acq_rel)) {
+        }
+        if (word_state(word) == slot_state::done)
+          continue;
+        auto evt = slot._event;
+        if (armed(word)) {
+          _metrics.on_stop();
+          count += 1;
+          if (_recorder.active())
+            _recorder.append(now(), workload_recorder::make(trace_op::stop, *evt, _precision));
+        }
+        release_unsafe(evt->_handle, false);
+        if (evt->_cold)
+          stopped.emplace_back(std::move(evt));
+      }
+    }
+
+    for (const auto &evt : stopped)
+      event_interface::stopped(evt);
+    return count;
+  }
+
+  inline const metrics_tt &metrics() const {
+    return _metrics;
+  }
+
+  inline bool remark(const timer_handle &handle, std::string remark) {
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    const auto &evt = find_unsafe(handle);
+    if (evt == nullptr)
+      return false;
+    evt->cold()._remark = std::move(remark);
+    return true;
+  }
+
+  // 开启慢回调检测：耗时 >= threshold 的回调交给 hook；与 execute 同线程调用
+  inline void profile(std::chrono::nanoseconds threshold, slow_callback_hook &&hook = nullptr) {
+    auto profiler = std::make_unique<callback_profiler>(threshold, std::forward<slow_callback_hook>(hook));
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    _profiler = std::move(profiler);
+  }
+
+  inline void profile_off() {
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    _profiler = nullptr;
+  }
+
+  inline std::vector<slow_callback_stat> slow_callbacks(std::size_t n) {
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    if (_profiler == nullptr)
+      return {};
+    return _profiler->top(n);
+  }
+
+  inline time_duration max_lateness() {
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    if (_profiler == nullptr)
+      return time_duration(0);
+    return _profiler->max_lateness();
+  }
+
+  /**
+   * \brief 开启负载记录（清空之前的记录），reserve 为预留条数
+   * 记录 add / stop / 重排 / 触发，trace_save 导出后由 replay_test.cpp 回放
+   */
+  inline void trace_on(std::size_t reserve = 0) {
+    _recorder.start(now(), reserve);
+  }
+
+  inline void trace_off() {
+    _recorder.stop();
+  }
+
+  // 写成 trace_header + trace_record[]，返回条数；记录可以仍在进行
+  inline std::size_t trace_save(std::vector<unsigned char> &out) {
+    return _recorder.save(out, _precision);
+  }
+
+  inline bool trace_save(const std::string &path) {
+    std::vector<unsigned char> data;
+    trace_save(data);
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+      return false;
+    const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && ok;
+  }
+
+  // 回调投递策略，alert_affinity 的工作线程通过它 drain
+  inline alert &alerts() {
+    return _alert;
+  }
+
+  // 时间源的当前毫秒
+  inline time64_t now() const {
+    return _time.now();
+  }
+
+  /**
+   * \brief 虚拟时间快进（仅 time_tt = virtual_time）
+   * 按到期顺序触发 [当前, time] 内的所有定时器，中间直接跳到下一个非空桶对应的 tick，不逐 tick 扫描
+   * 回调里看到的 now() 是它所在 tick 的虚拟时间，周期定时器和回调里 add 的定时器都以此为基准
+   */
+  inline void advance_to(time64_t time) {
+    static_assert(time_tt::is_virtual, "advance_to requires virtual_time");
+    alloc_guard guard(_reserved);
+    const auto target = time / _precision;
+    reclaim_cancelled();
+    budget_state budget;
+    while (_tick <= target) {
+      _time.set(std::max(_time.now(), _tick * _precision));
+      _tick_now = _tick;
+      step_tick_unsafe(budget);
+      if (_tick == target)
+        break;
+
+      std::scoped_lock<mutex_tt> lock(_mutex);
+      _tick = next_tick_unsafe(target);
+    }
+    _alert.alert_flush();
+    _time.set(std::max(_time.now(), time));
+  }
+
+  template <class Rep, class Period>
+  inline void advance(const std::chrono::duration<Rep, Period> &span) {
+    advance_to(now() + std::chrono::duration_cast<time_duration>(span).count());
+  }
+
+  inline void execute() {
+    execute(execute_budget());
+  }
+
+  /**
+   * \brief 限量执行：回调数或时间用完时在桶中间停下，_tick 和桶里剩下的句柄原样保留，下次调用接着处理
+   * 返回值报告剩余积压，可据此把负载摊到后面几帧
+   */
+  inline execute_result execute(const execute_budget &budget) {
+    [[maybe_unused]] std::chrono::steady_clock::time_point begin;
+    if constexpr (metrics_tt::enabled)
+      begin = std::chrono::steady_clock::now();
+
+    budget_state state;
+    state._left = budget._callbacks;
+    state._deadline = budget._deadline;
+    state._timed = budget._deadline != std::chrono::steady_clock::time_point::max();
+    state._exempt = budget._exempt;
+
+    execute_result result;
+    {
+      alloc_guard guard(_reserved);
+      const auto tick_now = execute_unsafe(state);
+      _alert.alert_flush();
+      result._fired = state._fired;
+      result._deferred = _deferred._size;
+      if (state._bucket_left) {
+        result._ticks_behind = tick_now >= _tick ? tick_now - _tick + 1 : 0;
+        result._bucket_left = state._bucket_left;
+      }
+      result._finished = result._bucket_left == 0 && result._deferred == 0;
+    }
+
+    if constexpr (metrics_tt::enabled)
+      _metrics.on_execute(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+    return result;
+  }
+
+ private:
+  inline time64_t execute_unsafe(budget_state &budget) {
+    const auto tick_now = now() / _precision;
+    _tick_now = tick_now;
+
+    reclaim_cancelled();
+
+    if (_deferred._size) {
+      step_list(_deferred, level_count, budget);
+      flush_batches();
+    }
+
+    while (_tick <= tick_now) {
+      step_tick_unsafe(budget);
+
+      if (budget._bucket_left || _tick == tick_now)
+        break;
+
+      if (_sparse.load(std::memory_order_relaxed)) {
+        std::scoped_lock<mutex_tt> lock(_mutex);
+        _tick = next_tick_unsafe(tick_now);
+      } else {
+        _tick += 1;
+      }
+    }
+    return tick_now;
+  }
+
+  // execute 开头回收 stop 没拿到锁时压栈的定时器，stopped_callback 在这里投递
+  inline void reclaim_cancelled() {
+    if (_cancelled.load(std::memory_order_relaxed) == handle_gen::invalid_next)
+      return;
+    std::vector<std::shared_ptr<event_interface>> reclaimed;
+    {
+      std::scoped_lock<mutex_tt> lock(_mutex);
+      reclaim_cancelled_unsafe(reclaimed);
+    }
+    alloc_guard pause(false);
+    for (const auto &evt : reclaimed)
+      _alert.alert_stopped(evt);
+  }
+
+  inline static bool budget_exhausted(budget_state &budget) {
+    if (budget._left == 0 || (budget._timed && std::chrono::steady_clock::now() >= budget._deadline))
+      budget._hit = true;
+    return budget._hit;
+  }
+
+  // 处理 _tick 这一格：最细的非 0 位所在层的桶
+  inline void step_tick_unsafe(budget_state &budget) {
+    if (_tick >= _overflow_tick.load(std::memory_order_relaxed)) {
+      std::scoped_lock<mutex_tt> lock(_mutex);
+      migrate_unsafe();
+    }
+
+    clock clk = {_tick};
+    auto *coarse = _coarse.load(std::memory_order_acquire);
+
+    if (clk._5()) {
+      step_list(_fine[clk._5()], 5, budget);
+    } else if (coarse == nullptr) {
+      // 还没切到过时间轮：只有最细层
+    } else if (clk._4()) {
+      step_list(coarse[clk._4()], 4, budget);
+    } else if (clk._3()) {
+      step_list(coarse[clk._3() + clock::_4_edge], 3, budget);
+    } else if (clk._2()) {
+      step_list(coarse[clk._2() + clock::_3_edge + clock::_4_edge], 2, budget);
+    } else if (clk._1()) {
+      step_list(coarse[clk._1() + clock::_2_edge + clock::_3_edge + clock::_4_edge], 1, budget);
+    } else {
+      // 全 0 即新一圈开头：最粗层的 0 号格放的是上一圈提前迁入的定时器
+      step_list(coarse[clk._0() + clock::_1_edge + clock::_2_edge + clock::_3_edge + clock::_4_edge], 0, budget);
+    }
+
+    // _5 == 0 时 submit 到当前 tick 的事件落在 _fine[0]，上面的分支不会扫到
+    if (clk._5() == 0 && budget._bucket_left == 0)
+      step_list(_fine[0], 5, budget);
+
+    flush_batches();
+  }
+
+  inline bool batched(uint32_t type) const {
+    return type < _sinks.size() && _sinks[type]._handler;
+  }
+
+  inline bool typed_registered(uint32_t type) const {
+    return (type < _typed.size() && _typed[type]) || batched(type);
+  }
+
+  // 批量事件到期：只记下句柄和 payload，tick 结束时由 flush_batches 统一回调
+  inline void collect(const std::shared_ptr<event_interface> &evt) {
+    const auto &typed = static_cast<const event_typed<_precision> &>(*evt);
+    auto &sink = _sinks[typed._type];
+    const auto count = sink._handles.size();
+    // 缓冲按历史峰值保留，稳态不再分配
+    if (count == sink._handles.capacity()) {
+      alloc_guard pause(false);
+      sink._handles.reserve(std::max<std::size_t>(count * 2, 64));
+      sink._payloads.reserve(sink._handles.capacity() * sink._stride);
+      if (count == 0)
+        _dirty_sinks.reserve(_sinks.size());
+    }
+    if (count == 0)
+      _dirty_sinks.push_back(typed._type);
+    _metrics.on_fire(0);
+    sink._handles.push_back(evt->_handle);
+    const auto offset = sink._payloads.size();
+    sink._payloads.resize(offset + sink._stride);
+    std::memcpy(sink._payloads.data() + offset, typed._payload.data(), sink._stride);
+  }
+
+  inline void flush_batches() {
+    if (_dirty_sinks.empty())
+      return;
+    alloc_guard pause(false);
+    for (std::size_t i = 0; i < _dirty_sinks.size(); ++i) {
+      const auto type = _dirty_sinks[i];
+      if (_sinks[type]._handles.empty())
+        continue;
+      // 回调里重入 execute 时攒到新的缓冲里，调用完再把容量还回去
+      auto handles = std::move(_sinks[type]._handles);
+      auto payloads = std::move(_sinks[type]._payloads);
+      if constexpr (metrics_tt::enabled) {
+        const auto begin = std::chrono::steady_clock::now();
+        _sinks[type]._handler(handles.data(), payloads.data(), handles.size());
+        _metrics.on_batch(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+      } else {
+        _sinks[type]._handler(handles.data(), payloads.data(), handles.size());
+      }
+      handles.clear();
+      payloads.clear();
+      if (_sinks[type]._handles.empty()) {
+        _sinks[type]._handles = std::move(handles);
+        _sinks[type]._payloads = std::move(payloads);
+      }
+    }
+    _dirty_sinks.clear();
+  }
+
+  // _tick 之后第一个有桶要处理的 tick，没有则返回 limit
+  // 某层的格子为空时，它覆盖的整段时间里更细的层也不会有事件级联下来，可以整段跳过
+  inline time64_t next_tick_unsafe(time64_t limit) const {
+    limit = std::min(limit, _overflow_tick.load(std::memory_order_relaxed));
+    const auto *coarse = _coarse.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < (coarse ? level_count : 1); ++i) {
+      const auto shift = level_shifts[i];
+      const auto edge = time64_t(1) << level_bits[i];
+      const auto digit = (_tick >> shift) & (edge - 1);
+      for (auto d = digit + 1; d < edge; ++d) {
+        if ((i ? coarse[level_offsets[i] - clock::_5_edge + d] : _fine[d])._size == 0)
+          continue;
+        const auto base = (_tick >> (shift + level_bits[i])) << (shift + level_bits[i]);
+        return std::min(limit, base | (d << shift));
+      }
+    }
+    if (coarse == nullptr)
+      return limit;
+    // 最粗层当前格之前的格子属于下一圈
+    const auto shift = level_shifts[level_count - 1];
+    const auto digit = (_tick >> shift) & (clock::_0_edge - 1);
+    for (time64_t d = 0; d < digit; ++d) {
+      if (coarse[level_offsets[level_count - 1] - clock::_5_edge + d]._size == 0)
+        continue;
+      const auto base = ((_tick >> clock::_span_bits) + 1) << clock::_span_bits;
+      return std::min(limit, base | (d << shift));
+    }
+    return limit;
+  }
+
+  template <class Rep, class Period>
+  inline time64_t deadline(const std::chrono::duration<Rep, Period> &when) const {
+    return (now() + std::chrono::duration_cast<time_duration>(when).count()) / _precision;
+  }
+
+  inline timer_handle insert(const std::shared_ptr<event_interface> &evt) {
+    const auto due = evt->_next * _precision;
+    std::scoped_lock<mutex_tt> lock(_mutex);
+    const auto handle = insert_unsafe(evt);
+    if (_recorder.active() && handle != handle_gen::invalid_handle)
+      trace(trace_op::add, *evt, due);
+    return handle;
+  }
+
+  // 记录 add / reschedule（到期时间 due）或 fire（预定时间 due）
+  inline void trace(trace_op op, const event_interface &evt, time64_t due) {
+    const auto now_ = now();
+    const auto duration = op == trace_op::fire ? (now_ > due ? now_ - due : 0) : (due > now_ ? due - now_ : 0);
+    _recorder.append(now_, workload_recorder::make(op, evt, _precision, duration));
+  }
+
+  inline static void apply_options(event_interface &evt, const timer_options &options) {
+    const auto slack = std::max<time64_t>(options._slack.count(), 0) / _precision;
+    evt._slack = static_cast<uint32_t>(std::min<time64_t>(slack, UINT32_MAX));
+
+    evt._owner = options._owner;
+    evt._affinity = options._affinity;
+    evt._lane = static_cast<uint8_t>(std::min<std::size_t>(static_cast<std::size_t>(options._lane), lane_count - 1));
+
+    evt._resolution = resolution_shift(std::max<time64_t>(options._resolution.count(), 0) / _precision);
+
+    if (options._period_mode == period_mode::fixed_rate && evt._period > 0) {
+      std::size_t limit = 1;
+      if (options._catch_up == catch_up_policy::skip)
+        limit = 0;
+      else if (options._catch_up == catch_up_policy::burst)
+        limit = std::clamp<std::size_t>(options._burst_limit, 1, UINT8_MAX - 1);
+      evt._rate = static_cast<uint8_t>(1 + limit);
+    }
+
+    const auto spread = std::max<time64_t>(options._spread.count(), 0) / _precision;
+    if (spread > 1 && options._spread_mode != spread_mode::none) {
+      evt._spread = static_cast<uint8_t>(options._spread_mode);
+      evt._slack = static_cast<uint32_t>(std::min<time64_t>(spread, UINT32_MAX));
+      evt._resolution = 0;
+    }
+  }
+
+  // 不超过 ticks 的最粗层的 shift，0 表示不对齐
+  inline static uint8_t resolution_shift(time64_t ticks) {
+    uint8_t result = 0;
+    for (const auto shift : level_shifts) {
+      if ((time64_t(1) << shift) <= ticks)
+        result = shift;
+    }
+    return result;
+  }
+
+  // 快照里的选项按当前精度换算回 tick；打散的返回 true，相位已写进 _shift
+  inline static bool restore_options(event_interface &evt, const snapshot_record &record) {
+    evt._owner = record._owner;
+    evt._affinity = record._affinity;
+    evt._lane = static_cast<uint8_t>(std::min<std::size_t>(record._lane, lane_count - 1));
+    evt._rate = evt._period > 0 ? record._rate : 0;
+    evt._slack = record._slack / _precision;
+    evt._resolution = resolution_shift(record._resolution / _precision);
+    if (record._spread == 0 || evt._slack <= 1)
+      return false;
+    evt._spread = record._spread;
+    evt._resolution = 0;
+    evt._shift = static_cast<uint32_t>(record._phase / _precision % evt._slack);
+    return true;
+  }
+
+  inline static uint64_t mix64(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+  }
+
+  // 只在 insert 时选一次相位，记在 _shift 里
+  inline uint32_t spread_phase_unsafe(const event_interface &evt) {
+    uint64_t key = evt._owner ? evt._owner : handle_gen::index(evt._handle);
+    if (static_cast<spread_mode>(evt._spread) == spread_mode::random)
+      key = _spread_seed += 0x9E3779B97F4A7C15ull;
+    return static_cast<uint32_t>(mix64(key) % evt._slack);
+  }
+
+  // next 之后第一个 tick % window == phase 的 tick
+  inline static time64_t spread_target(time64_t next, uint64_t window, uint64_t phase) {
+    return next + (phase + window - next % window) % window;
+  }
+
+  inline static time64_t period_ticks(const event_interface &evt) {
+    return std::max<time64_t>((evt._period + _precision / 2) / _precision, 1);
+  }
+
+  // fixed_rate 的节拍点：去掉 slack/resolution 的推迟，打散的相位本身就在节拍上
+  inline static time64_t rate_origin(const event_interface &evt) {
+    return evt._spread ? evt._next : evt._next - static_cast<time64_t>(evt._shift);
+  }
+
+  // 到本次 execute 追到的 tick 为止，又错过了几个后续节拍
+  inline time64_t missed_periods(const event_interface &evt) const {
+    const auto origin = rate_origin(evt);
+    const auto tick_now = std::max(_tick, _tick_now);
+    return tick_now > origin ? (tick_now - origin) / period_ticks(evt) : 0;
+  }
+
+  // fixed_rate 重排：按节拍前进，错过的节拍最多补 _rate - 1 次（含刚触发的这次）；
+  // skip（_rate == 1）刚为当前周期触发过，直接对齐到当前 tick 之后的节拍
+  inline void rearm_fixed_rate(event_interface &evt) const {
+    const auto period = period_ticks(evt);
+    const auto missed = missed_periods(evt);
+    const auto limit = static_cast<time64_t>(evt._rate - 1);
+    auto fired = rate_origin(evt);
+    if (limit == 0)
+      fired += missed * period;
+    else if (missed + 1 > limit)
+      fired += (missed + 1 - limit) * period;
+    evt._next = fired + period;
+  }
+
+  // 新到期时间的放置，只做一次（insert、周期重排），级联重新 submit 时不再移动：
+  // 1. 向上对齐到 resolution 层的格子
+  // 2. 在 [next, next + slack] 里取末尾 0 最多的 tick：同窗口的定时器落到同一个对齐 tick 上
+  inline void align_unsafe(event_interface &evt) {
+    if (evt._spread) {
+      evt._next = spread_target(std::max(evt._next, _tick), evt._slack, evt._shift);
+      return;
+    }
+    evt._shift = 0;
+    if (evt._slack == 0 && evt._resolution == 0)
+      return;
+    auto target = std::max(evt._next, _tick);
+    if (evt._resolution) {
+      const auto mask = (time64_t(1) << evt._resolution) - 1;
+      target = (target + mask) & ~mask;
+    }
+    if (evt._slack) {
+      const auto begin = target;
+      target += static_cast<time64_t>(evt._slack);
+      while ((target & (target - 1)) >= begin)
+        target &= target - 1;
+      if (target != begin)
+        _metrics.on_coalesce();
+    }
+    if (target <= evt._next)
+      return;
+    evt._shift = static_cast<uint32_t>(std::min<time64_t>(target - evt._next, UINT32_MAX));
+    evt._next = target;
+  }
+
+  // 统计同一 tick 内触发的不同原始到期 tick，多出来的就是合并省下的唤醒
+  inline void count_wakeup_unsafe(const event_interface &evt) {
+    if (_wakeup_tick != _tick) {
+      _wakeup_tick = _tick;
+      _wakeup_origins.clear();
+      _metrics.on_wakeup();
+    }
+    const auto origin = rate_origin(evt);
+    const auto iter = std::lower_bound(_wakeup_origins.begin(), _wakeup_origins.end(), origin);
+    if (iter != _wakeup_origins.end() && *iter == origin)
+      return;
+    if (_wakeup_origins.size() == _wakeup_origins.capacity()) {
+      alloc_guard pause(false);
+      _wakeup_origins.insert(iter, origin);
+    } else {
+      _wakeup_origins.insert(iter, origin);
+    }
+    if (_wakeup_origins.size() > 1)
+      _metrics.on_tick_saved();
+  }
+
+  // keep_phase：打散相位已经给定（restore），不再重新选
+  inline timer_handle insert_unsafe(const std::shared_ptr<event_interface> &evt, bool keep_phase = false) {
+    // 先切模式再 submit：堆里迁出的旧定时器排在新定时器前面
+    if (++_count > _dense_above && _sparse.load(std::memory_order_relaxed))
+      switch_unsafe(false);
+
+    uint32_t index = _free_slot;
+    if (index == handle_gen::invalid_next) {
+      index = _slots.emplace_back();
+    } else {
+      _free_slot = _slots[index]._link;
+      _slots[index]._link = handle_gen::unlinked;
+    }
+
+    auto &slot = _slots[index];
+    slot._event = evt;
+    const auto generation = word_generation(slot._state.load(std::memory_order_relaxed));
+    evt->_handle = handle_gen::make(index, generation);
+    slot._state.store(state_word(generation, slot_state::pending), std::memory_order_release);
+    if (evt->_owner)
+      link_owner_unsafe(index, evt->_owner);
+    if (evt->_spread && !keep_phase)
+      evt->_shift = spread_phase_unsafe(*evt);
+    align_unsafe(*evt);
+    submit_unsafe(evt);
+    _metrics.on_add();
+    return evt->_handle;
+  }
+
+  // pending / firing：还会触发，可以 stop
+  inline static bool armed(uint32_t word) {
+    return word_state(word) == slot_state::pending || word_state(word) == slot_state::firing;
+  }
+
+  inline const std::shared_ptr<event_interface> &find_unsafe(const timer_handle &handle) {
+    static const std::shared_ptr<event_interface> empty = nullptr;
+    const auto index = handle_gen::index(handle);
+    if (index >= _slots.size())
+      return empty;
+    const auto word = _slots[index]._state.load(std::memory_order_acquire);
+    if (word_generation(word) != handle_gen::generation(handle) || !armed(word))
+      return empty;
+    return _slots[index]._event;
+  }
+
+  // 调用方保证 handle 有效；仍挂在桶上的槽位等 step_list 摘下时再回收
+  inline void release_unsafe(const timer_handle &handle, bool unlink_owner = true) {
+    const auto index = handle_gen::index(handle);
+    auto &slot = _slots[index];
+    if (unlink_owner && slot._event->_owner)
+      unlink_owner_unsafe(index, slot._event->_owner);
+    slot._event = nullptr;
+    auto generation = (word_generation(slot._state.load(std::memory_order_relaxed)) + 1) & (UINT32_MAX >> 2);
+    if (generation == 0)
+      generation = 1;
+    slot._state.store(state_word(generation, slot_state::done), std::memory_order_release);
+    // 还在待回收栈上的槽位先不放回空闲链表，否则复用后可能被再压一次；由 reclaim_cancelled_unsafe 放回
+    const bool queued = slot._reclaim.load(std::memory_order_acquire) != handle_gen::unlinked;
+    if (slot._link == handle_gen::overflowed) {
+      slot._link = handle_gen::unlinked;
+      if (!queued)
+        free_unsafe(index);
+      if (++_overflow_dead > overflow_slack && _overflow_dead * 2 > _overflow.size())
+        compact_overflow_unsafe();
+    } else if (slot._link == handle_gen::unlinked && !queued) {
+      free_unsafe(index);
+    }
+
+    if (--_count < _sparse_below && !_sparse.load(std::memory_order_relaxed))
+      switch_unsafe(true);
+  }
+
+  // 切到时间轮时立即迁入同一圈内的堆条目，之后 add 的同 tick 定时器才能排在它们后面
+  inline void switch_unsafe(bool sparse) {
+    if (!sparse)
+      grow_wheels_unsafe();
+    _sparse.store(sparse, std::memory_order_relaxed);
+    if (sparse)
+      update_overflow_unsafe();
+    else
+      migrate_unsafe();
+  }
+
+  // 粗层只分配一次，切回小根堆模式时留着（上面可能还有定时器）
+  inline void grow_wheels_unsafe() {
+    if (_coarse_buckets)
+      return;
+    _coarse_buckets = std::make_unique<bucket[]>(bucket_count - clock::_5_edge);
+    _coarse.store(_coarse_buckets.get(), std::memory_order_release);
+  }
+
+  inline void link_owner_unsafe(uint32_t index, uint64_t owner) {
+    // 新 owner 的第一个定时器会在 map 里分配节点（reserve 之外的分配）
+    alloc_guard pause(false);
+    auto [iter, inserted] = _owners.try_emplace(owner, index);
+    auto &slot = _slots[index];
+    slot._owner_prev = handle_gen::invalid_next;
+    slot._owner_next = inserted ? handle_gen::invalid_next : iter->second;
+    if (!inserted) {
+      _slots[iter->second]._owner_prev = index;
+      iter->second = index;
+    }
+  }
+
+  inline void unlink_owner_unsafe(uint32_t index, uint64_t owner) {
+    auto &slot = _slots[index];
+    if (slot._owner_next != handle_gen::invalid_next)
+      _slots[slot._owner_next]._owner_prev = slot._owner_prev;
+    if (slot._owner_prev != handle_gen::invalid_next) {
+      _slots[slot._owner_prev]._owner_next = slot._owner_next;
+    } else {
+      // stop_group 已经摘掉整条链时，map 里可能是同一 owner 新建的链
+      const auto iter = _owners.find(owner);
+      if (iter != _owners.end() && iter->second == index) {
+        if (slot._owner_next != handle_gen::invalid_next)
+          iter->second = slot._owner_next;
+        else
+          _owners.erase(iter);
+      }
+    }
+    slot._owner_prev = handle_gen::invalid_next;
+    slot._owner_next = handle_gen::invalid_next;
+  }
+
+  inline void free_unsafe(uint32_t index) {
+    _slots[index]._link = _free_slot;
+    _free_slot = index;
+  }
+
+  // 不加锁：压栈前先认领槽位，同一槽位已经在栈上（上一代还没回收）就不再压，回收时按当前状态处理
+  // 认领与 stop 的 CAS、回收时的 exchange 与状态读取都是 seq_cst：认领失败时回收方一定能看到 cancelled
+  inline void push_cancelled(event_slot &slot, uint32_t index) {
+    uint32_t expected = handle_gen::unlinked;
+    if (!slot._reclaim.compare_exchange_strong(expected, handle_gen::invalid_next))
+      return;
+    auto head = _cancelled.load(std::memory_order_relaxed);
+    do {
+      slot._reclaim.store(head, std::memory_order_relaxed);
+    } while (!_cancelled.compare_exchange_weak(head, index, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  // 整栈取下：仍是 cancelled 的回收，带停止回调的放进 stopped 解锁后执行；已被回收但没放回空闲链表的补上
+  inline void reclaim_cancelled_unsafe(std::vector<std::shared_ptr<event_interface>> &stopped) {
+    if (_cancelled.load(std::memory_order_relaxed) == handle_gen::invalid_next)
+      return;
+    auto index = _cancelled.exchange(handle_gen::invalid_next, std::memory_order_acquire);
+    while (index != handle_gen::invalid_next) {
+      auto &slot = _slots[index];
+      const auto next = slot._reclaim.exchange(handle_gen::unlinked);
+      if (word_state(slot._state.load()) == slot_state::cancelled) {
+        auto evt = slot._event;
+        release_unsafe(evt->_handle);
+        if (evt->_cold) {
+          alloc_guard pause(false);
+          stopped.emplace_back(std::move(evt));
+        }
+      } else if (slot._event == nullptr && slot._link == handle_gen::unlinked) {
+        free_unsafe(index);
+      }
+      index = next;
+    }
+  }
+
+  inline void push_unsafe(bucket &bkt, uint32_t index, uint8_t lane) {
+    auto &slot = _slots[index];
+    auto &lst = bkt._lanes[lane];
+    slot._link = handle_gen::invalid_next;
+    if (lst._tail == handle_gen::invalid_next)
+      lst._head = index;
+    else
+      _slots[lst._tail]._link = index;
+    lst._tail = index;
+    bkt._size += 1;
+  }
+
+  // 放回桶头（step_list 没处理完的批次）
+  inline void push_front_unsafe(bucket &bkt, uint32_t index, uint8_t lane) {
+    auto &lst = bkt._lanes[lane];
+    _slots[index]._link = lst._head;
+    if (lst._tail == handle_gen::invalid_next)
+      lst._tail = index;
+    lst._head = index;
+    bkt._size += 1;
+  }
+
+  // 调用方保证桶非空
+  inline uint32_t pop_unsafe(bucket &bkt) {
+    auto lane = lane_count - 1;
+    while (bkt._lanes[lane]._head == handle_gen::invalid_next)
+      lane -= 1;
+    auto &lst = bkt._lanes[lane];
+    const auto index = lst._head;
+    auto &slot = _slots[index];
+    lst._head = slot._link;
+    if (lst._head == handle_gen::invalid_next)
+      lst._tail = handle_gen::invalid_next;
+    bkt._size -= 1;
+    slot._link = handle_gen::unlinked;
+    return index;
+  }
+
+  // 到期 tick 为 next 的定时器最早可以放进时间轮的 tick：进入 horizon，且最粗层的格子在那时已经走过（下一圈）
+  // 或还没走到（同一圈）；horizon 不超过 max_horizon 时后者总是满足，即 next - horizon
+  // 稀疏模式下 horizon 视为 0，到期那个 tick 才迁入
+  inline time64_t overflow_tick(time64_t next) const {
+    const auto horizon = _sparse.load(std::memory_order_relaxed) ? 0 : _horizon;
+    const auto granule = (next & ~(rotation_granule - 1)) + rotation_granule;
+    const auto placeable = granule > wheel_ticks ? granule - wheel_ticks : 0;
+    return std::max(next > horizon ? next - horizon : 0, placeable);
+  }
+
+  inline static bool overflow_later(const overflow_entry &lhs, const overflow_entry &rhs) {
+    return lhs._next != rhs._next ? lhs._next > rhs._next : lhs._seq > rhs._seq;
+  }
+
+  inline bool overflow_alive(const overflow_entry &entry) {
+    auto &slot = _slots[entry._index];
+    return slot._event && word_generation(slot._state.load(std::memory_order_relaxed)) == entry._generation;
+  }
+
+  // 频繁 stop 远期定时器时堆里的死条目不等到期就清掉
+  inline void compact_overflow_unsafe() {
+    const auto size = _overflow.size();
+    _overflow.erase(std::remove_if(_overflow.begin(), _overflow.end(),
+                      [this](const overflow_entry &entry) { return !overflow_alive(entry); }),
+      _overflow.end());
+    _metrics.on_tombstone(size - _overflow.size());
+    std::make_heap(_overflow.begin(), _overflow.end(), overflow_later);
+    _overflow_dead = 0;
+    update_overflow_unsafe();
+  }
+
+  inline void update_overflow_unsafe() {
+    const auto tick_ = _overflow.empty() ? std::numeric_limits<time64_t>::max() : overflow_tick(_overflow.front()._next);
+    _overflow_tick.store(tick_, std::memory_order_relaxed);
+  }
+
+  // 把可以迁入的 overflow 定时器 submit 到时间轮，已回收的跳过
+  inline void migrate_unsafe() {
+    while (!_overflow.empty() && overflow_tick(_overflow.front()._next) <= _tick) {
+      std::pop_heap(_overflow.begin(), _overflow.end(), overflow_later);
+      const auto entry = _overflow.back();
+      _overflow.pop_back();
+      if (overflow_alive(entry)) {
+        auto &slot = _slots[entry._index];
+        slot._link = handle_gen::unlinked;
+        submit_unsafe(slot._event);
+      } else {
+        _metrics.on_tombstone();
+        if (_overflow_dead)
+          _overflow_dead -= 1;
+      }
+    }
+    update_overflow_unsafe();
+  }
+
+  inline void submit_unsafe(const std::shared_ptr<event_interface> &evt) {
+    if (nullptr == evt)
+      return;
+
+    // 解锁期间可能已被 stop
+    const auto index = handle_gen::index(evt->_handle);
+    if (_slots[index]._event != evt)
+      return;
+
+    if (evt->_next < _tick) {
+      evt->_next = _tick;
+    }
+    _slots[index]._due.store(evt->_next, std::memory_order_relaxed);
+
+    if (_tick < overflow_tick(evt->_next)) {
+      _overflow.push_back({evt->_next, _overflow_seq++, index, handle_gen::generation(evt->_handle)});
+      std::push_heap(_overflow.begin(), _overflow.end(), overflow_later);
+      _slots[index]._link = handle_gen::overflowed;
+      update_overflow_unsafe();
+      return;
+    }
+
+    clock clk1 = {evt->_next};
+    clock clk2 = {_tick};
+    const auto lane = evt->_lane;
+    // 小根堆模式下只有到期 tick 就是当前 tick 的会走到这里，落在最细层；粗层此时可能还没分配
+    auto *coarse = _coarse.load(std::memory_order_relaxed);
+
+    if (clk1._0() != clk2._0()) {
+      push_unsafe(coarse[clock::_4_edge + clock::_3_edge + clock::_2_edge + clock::_1_edge + clk1._0()], index, lane);
+      _metrics.on_submit(0);
+    } else if (clk1._1() != clk2._1()) {
+      push_unsafe(coarse[clock::_4_edge + clock::_3_edge + clock::_2_edge + clk1._1()], index, lane);
+      _metrics.on_submit(1);
+    } else if (clk1._2() != clk2._2()) {
+      push_unsafe(coarse[clock::_4_edge + clock::_3_edge + clk1._2()], index, lane);
+      _metrics.on_submit(2);
+    } else if (clk1._3() != clk2._3()) {
+      push_unsafe(coarse[clock::_4_edge + clk1._3()], index, lane);
+      _metrics.on_submit(3);
+    } else if (clk1._4() != clk2._4()) {
+      push_unsafe(coarse[clk1._4()], index, lane);
+      _metrics.on_submit(4);
+    } else {
+      push_unsafe(_fine[clk1._5()], index, lane);
+      _metrics.on_submit(5);
+    }
+  }
+
+  inline void fire(const std::shared_ptr<event_interface> &evt) {
+    alloc_guard pause(false);
+    if (!metrics_tt::enabled && _profiler == nullptr) {
+      _alert.alert_callback(evt);
+      return;
+    }
+
+    const auto scheduled = evt->_next * _precision;
+    const auto fired = _profiler ? now() : scheduled;
+    const auto begin = std::chrono::steady_clock::now();
+    _alert.alert_callback(evt);
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    _metrics.on_fire(
+      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+
+    if (_profiler) {
+      const auto lateness = time_duration(fired > scheduled ? fired - scheduled : 0);
+      const auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+      // hook 可能 add / remark / profile，拷出来解锁后再调用
+      slow_callback_hook hook = nullptr;
+      std::string remark;
+      {
+        std::scoped_lock<mutex_tt> lock(_mutex);
+        if (_profiler && _profiler->record(evt->remark(), elapsed_ns, lateness) && _profiler->hook()) {
+          hook = _profiler->hook();
+          remark = evt->remark();
+        }
+      }
+      if (hook)
+        hook(evt->_handle, remark, elapsed_ns, lateness);
+    }
+  }
+
+  /**
+   * \brief 处理一个桶：每批在一次加锁里摘下最多 batch_limit 个句柄，不持锁触发回调，
+   * 再在一次加锁里提交级联、重排、推迟和回收；回调里 add 到同一个桶的定时器由下一批处理
+   * 触发前后各 CAS 一次槽位状态字，期间被 stop 的定时器不再触发，由提交阶段回收
+   */
+  inline void step_list(bucket &bkt, std::size_t level, budget_state &budget) {
+    if constexpr (metrics_tt::enabled) {
+      std::scoped_lock<mutex_tt> lock(_mutex);
+      _metrics.on_bucket(bkt._size);
+    }
+
+    // 回调里重入 execute 时各用各的批次
+    auto batch = std::move(_batch);
+    batch.clear();
+    // 没有豁免通道时停在桶中间；推迟队列自身不再往回推迟
+    const bool stop_in_bucket = budget._exempt >= lane_count || &bkt == &_deferred;
+
+    while (true) {
+      {
+        std::scoped_lock<mutex_tt> lock(_mutex);
+        if (bkt._size == 0)
+          break;
+        if (budget_exhausted(budget) && stop_in_bucket) {
+          if (&bkt != &_deferred)
+            budget._bucket_left = bkt._size;
+          break;
+        }
+        while (bkt._size && batch.size() < batch_limit) {
+          const auto index = pop_unsafe(bkt);
+          if (level < level_count)
+            _metrics.on_pop(level);
+
+          const auto &evt = _slots[index]._event;
+          if (evt == nullptr) {
+            free_unsafe(index);
+            _metrics.on_tombstone();
+            continue;
+          }
+          batch.push_back({evt, batch_action::pending});
+        }
+      }
+
+      bool stopped_early = false;
+      for (auto &item : batch) {
+        const auto &evt = item._event;
+        // 推迟队列里的定时器 _next < _tick
+        if (evt->_next > _tick) {
+          item._action = batch_action::cascade;
+          continue;
+        }
+        if (evt->_round && budget_exhausted(budget) && stop_in_bucket) {
+          stopped_early = true;
+          break;
+        }
+        if (evt->_round && budget._hit && evt->_lane < budget._exempt) {
+          item._action = batch_action::defer;
+          continue;
+        }
+
+        auto &state = _slots[handle_gen::index(evt->_handle)]._state;
+        const auto generation = handle_gen::generation(evt->_handle);
+        auto expected = state_word(generation, slot_state::pending);
+        if (!state.compare_exchange_strong(expected, state_word(generation, slot_state::firing),
+              std::memory_order_acq_rel)) {
+          item._action = batch_action::drop;
+          continue;
+        }
+        // 不持锁时只读事件字段，轮次和到期时间在提交阶段持锁写回，snapshot 不会读到一半
+        auto round = evt->_round;
+        // fixed_rate + skip：错过的整周期丢掉并扣掉轮次，至少留一轮给当前周期
+        if (round && evt->_rate == 1)
+          round -= std::min<uint64_t>(missed_periods(*evt), round - 1);
+        if (round) {
+          if constexpr (metrics_tt::enabled)
+            count_wakeup_unsafe(*evt);
+          if (_recorder.active())
+            trace(trace_op::fire, *evt, evt->_next * _precision);
+          if (evt->_kind == event_kind::batch)
+            collect(evt);
+          else
+            fire(evt);
+          budget._left -= 1;
+          budget._fired += 1;
+          round -= 1;
+        }
+
+        expected = state_word(generation, slot_state::firing);
+        if (!state.compare_exchange_strong(expected,
+              state_word(generation, round ? slot_state::pending : slot_state::done), std::memory_order_acq_rel)) {
+          item._action = batch_action::drop;
+          continue;
+        }
+        item._round = round;
+        item._now = now();
+        item._action = round ? batch_action::rearm : batch_action::finish;
+      }
+
+      std::size_t finished = 0;
+      {
+        std::scoped_lock<mutex_tt> lock(_mutex);
+        // 没处理到的倒序放回桶头，保持原来的顺序
+        for (auto i = batch.size(); i-- > 0;) {
+          const auto &evt = batch[i]._event;
+          const auto index = handle_gen::index(evt->_handle);
+          if (batch[i]._action == batch_action::pending && _slots[index]._event == evt &&
+              armed(_slots[index]._state.load(std::memory_order_acquire)))
+            push_front_unsafe(bkt, index, evt->_lane);
+        }
+        if (stopped_early && &bkt != &_deferred)
+          budget._bucket_left = bkt._size;
+
+        for (auto &item : batch) {
+          const auto &evt = item._event;
+          const auto index = handle_gen::index(evt->_handle);
+          // 已被 stop 并回收，或槽位已复用
+          if (_slots[index]._event != evt)
+            continue;
+          // 已被 stop 还没回收：在这里回收，stopped_callback 稍后在本线程执行
+          if (word_state(_slots[index]._state.load(std::memory_order_acquire)) == slot_state::cancelled) {
+            release_unsafe(evt->_handle);
+            _metrics.on_tombstone();
+            batch[finished++]._event = evt;
+            continue;
+          }
+          switch (item._action) {
+            case batch_action::cascade:
+              _metrics.on_cascade(level);
+              submit_unsafe(evt);
+              break;
+            case batch_action::rearm:
+              evt->_round = item._round;
+              if (evt->_rate)
+                rearm_fixed_rate(*evt);
+              else
+                evt->template next<_precision>(item._now);
+              if (_recorder.active())
+                trace(trace_op::reschedule, *evt, evt->_next * _precision);
+              align_unsafe(*evt);
+              submit_unsafe(evt);
+              break;
+            case batch_action::defer:
+              push_unsafe(_deferred, index, evt->_lane);
+              break;
+            case batch_action::finish:
+              evt->_round = 0;
+              release_unsafe(evt->_handle);
+              _metrics.on_finish();
+              batch[finished++]._event = evt;
+              break;
+            default:
+              break;
+          }
+        }
+      }
+
+      {
+        alloc_guard pause(false);
+        for (std::size_t i = 0; i < finished; ++i)
+          _alert.alert_stopped(batch[i]._event);
+      }
+      batch.clear();
+      if (stopped_early)
+        break;
+    }
+
+    _batch = std::move(batch);
+  }
+
+};
+
 static timer_wheel<> &instance() {
   static timer_wheel<> inst;
   return inst;